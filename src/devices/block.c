@@ -188,7 +188,7 @@ block_register (const char *name, enum block_type type,
                 const char *extra_info, block_sector_t size,
                 const struct block_operations *ops, void *aux)
 {
-  struct block *block = malloc (sizeof *block);
+  struct block *block = malloc_tagged (sizeof *block, MEM_DEVICE);
   if (block == NULL)
     PANIC ("Failed to allocate memory for block device descriptor");
 
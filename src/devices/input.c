@@ -1,16 +1,22 @@
 #include "devices/input.h"
 #include <debug.h>
-#include "devices/intq.h"
+#include "devices/ring.h"
 #include "devices/serial.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
 
-/** Stores keys from the keyboard and serial port. */
-static struct intq buffer;
+/** Stores keys from the keyboard and serial port.  Interrupt
+   handlers are the only producers; readers take `lock', so there
+   is a single consumer. */
+static struct ring buffer;
+static struct lock lock;
 
 /** Initializes the input buffer. */
 void
 input_init (void) 
 {
-  intq_init (&buffer);
+  ring_init (&buffer);
+  lock_init (&lock);
 }
 
 /** Adds a key to the input buffer.
@@ -19,26 +25,58 @@ void
 input_putc (uint8_t key) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  ASSERT (!intq_full (&buffer));
+  ASSERT (!ring_full (&buffer));
 
-  intq_putc (&buffer, key);
+  ring_put (&buffer, &key, 1);
   serial_notify ();
 }
 
+/** Adds up to CNT keys from KEYS to the input buffer, as many as
+   fit, and returns the number added.  Interrupts must be off. */
+size_t
+input_putbuf (const uint8_t *keys, size_t cnt) 
+{
+  size_t added;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  added = ring_put (&buffer, keys, cnt);
+  serial_notify ();
+  return added;
+}
+
 /** Retrieves a key from the input buffer.
    If the buffer is empty, waits for a key to be pressed. */
 uint8_t
 input_getc (void) 
 {
-  enum intr_level old_level;
   uint8_t key;
 
+  input_read (&key, 1);
+  return key;
+}
+
+/** Reads up to CNT keys into KEYS, waiting until at least one is
+   available, and returns the number read. */
+size_t
+input_read (uint8_t *keys, size_t cnt) 
+{
+  enum intr_level old_level;
+  size_t read;
+
+  ASSERT (cnt > 0);
+
+  lock_acquire (&lock);
+  ring_wait_data (&buffer);
+  read = ring_get (&buffer, keys, cnt);
+  lock_release (&lock);
+
+  /* Room was made, so the serial port may receive again. */
   old_level = intr_disable ();
-  key = intq_getc (&buffer);
   serial_notify ();
   intr_set_level (old_level);
-  
-  return key;
+
+  return read;
 }
 
 /** Returns true if the input buffer is full,
@@ -48,5 +86,14 @@ bool
 input_full (void) 
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  return intq_full (&buffer);
+  return ring_full (&buffer);
+}
+
+/** Returns the number of keys that may be added to the input
+   buffer.  Interrupts must be off. */
+size_t
+input_space (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return ring_space (&buffer);
 }
@@ -7,10 +7,19 @@
 #include "devices/shutdown.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/workqueue.h"
 
 /** Keyboard data register port. */
 #define DATA_REG 0x60
 
+/** Keyboard controller status register port, and its bit that
+   says a byte is waiting in DATA_REG. */
+#define STATUS_REG 0x64
+#define STATUS_OBF 0x01
+
+/** Most characters passed to the input buffer per interrupt. */
+#define KEY_BATCH 16
+
 /** Current state of shift keys.
    True if depressed, false otherwise. */
 static bool left_shift, right_shift;    /**< Left and right Shift keys. */
@@ -24,12 +33,19 @@ static bool caps_lock;
 /** Number of keys pressed. */
 static int64_t key_cnt;
 
+/** Reboots the machine after Ctrl+Alt+Del.  shutdown_reboot()
+   prints and busy-waits on the keyboard controller, which is no
+   work for an interrupt handler, so it runs in the work queue. */
+static struct work reboot_work;
+
 static intr_handler_func keyboard_interrupt;
+static work_func reboot;
 
 /** Initializes the keyboard. */
 void
 kbd_init (void) 
 {
+  work_init (&reboot_work, reboot, NULL);
   intr_register_ext (0x21, keyboard_interrupt, "8042 Keyboard");
 }
 
@@ -91,9 +107,33 @@ static const struct keymap shifted_keymap[] =
   };
 
 static bool map_key (const struct keymap[], unsigned scancode, uint8_t *);
+static bool read_key (uint8_t *);
 
+/** Keyboard interrupt handler.  Decodes every scancode the
+   controller has buffered and passes the resulting characters to
+   the input buffer as one batch.  Characters that do not fit are
+   dropped. */
 static void
 keyboard_interrupt (struct intr_frame *args UNUSED) 
+{
+  uint8_t keys[KEY_BATCH];
+  size_t cnt = 0;
+
+  do
+    {
+      if (read_key (&keys[cnt]))
+        cnt++;
+    }
+  while (cnt < KEY_BATCH && (inb (STATUS_REG) & STATUS_OBF) != 0);
+
+  key_cnt += input_putbuf (keys, cnt);
+}
+
+/** Reads and interprets one scancode.  Returns true and stores the
+   character it produced in *C if it was an ordinary key press,
+   false otherwise. */
+static bool
+read_key (uint8_t *c) 
 {
   /* Status of shift keys. */
   bool shift = left_shift || right_shift;
@@ -106,9 +146,6 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
   /* False if key pressed, true if key released. */
   bool release;
 
-  /* Character that corresponds to `code'. */
-  uint8_t c;
-
   /* Read scancode, including second byte if prefix code. */
   code = inb (DATA_REG);
   if (code == 0xe0)
@@ -126,39 +163,37 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
       if (!release)
         caps_lock = !caps_lock;
     }
-  else if (map_key (invariant_keymap, code, &c)
-           || (!shift && map_key (unshifted_keymap, code, &c))
-           || (shift && map_key (shifted_keymap, code, &c)))
+  else if (map_key (invariant_keymap, code, c)
+           || (!shift && map_key (unshifted_keymap, code, c))
+           || (shift && map_key (shifted_keymap, code, c)))
     {
       /* Ordinary character. */
       if (!release) 
         {
           /* Reboot if Ctrl+Alt+Del pressed. */
-          if (c == 0177 && ctrl && alt)
-            shutdown_reboot ();
+          if (*c == 0177 && ctrl && alt) 
+            {
+              work_schedule (&reboot_work);
+              return false;
+            }
 
           /* Handle Ctrl, Shift.
              Note that Ctrl overrides Shift. */
-          if (ctrl && c >= 0x40 && c < 0x60) 
+          if (ctrl && *c >= 0x40 && *c < 0x60) 
             {
               /* A is 0x41, Ctrl+A is 0x01, etc. */
-              c -= 0x40; 
+              *c -= 0x40; 
             }
           else if (shift == caps_lock)
-            c = tolower (c);
+            *c = tolower (*c);
 
           /* Handle Alt by setting the high bit.
              This 0x80 is unrelated to the one used to
              distinguish key press from key release. */
           if (alt)
-            c += 0x80;
+            *c += 0x80;
 
-          /* Append to keyboard buffer. */
-          if (!input_full ())
-            {
-              key_cnt++;
-              input_putc (c);
-            }
+          return true;
         }
     }
   else
@@ -192,6 +227,7 @@ keyboard_interrupt (struct intr_frame *args UNUSED)
             break;
           }
     }
+  return false;
 }
 
 /** Scans the array of keymaps K for SCANCODE.
@@ -211,3 +247,10 @@ map_key (const struct keymap k[], unsigned scancode, uint8_t *c)
 
   return false;
 }
+
+/** Reboots the machine.  Runs as reboot_work. */
+static void
+reboot (void *aux UNUSED) 
+{
+  shutdown_reboot ();
+}
@@ -85,7 +85,7 @@ read_partition_table (struct block *block, block_sector_t sector,
 
   /* Read sector. */
   ASSERT (sizeof *pt == BLOCK_SECTOR_SIZE);
-  pt = malloc (sizeof *pt);
+  pt = malloc_tagged (sizeof *pt, MEM_DEVICE);
   if (pt == NULL)
     PANIC ("Failed to allocate memory for partition table.");
   block_read (block, 0, pt);
@@ -172,7 +172,7 @@ found_partition (struct block *block, uint8_t part_type,
       char extra_info[128];
       char name[16];
 
-      p = malloc (sizeof *p);
+      p = malloc_tagged (sizeof *p, MEM_DEVICE);
       if (p == NULL)
         PANIC ("Failed to allocate memory for partition descriptor");
       p->block = block;
@@ -0,0 +1,188 @@
+#include "devices/ring.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static bool wait (struct ring *, struct thread *volatile *waiter,
+                  bool (*ready) (const struct ring *));
+static void wake (struct thread *volatile *waiter);
+
+/** Initializes ring buffer R to empty. */
+void
+ring_init (struct ring *r) 
+{
+  r->head = r->tail = 0;
+  r->not_empty = r->not_full = NULL;
+}
+
+/** Returns the number of bytes in R. */
+size_t
+ring_used (const struct ring *r) 
+{
+  return r->head - r->tail;
+}
+
+/** Returns the number of bytes that may be added to R. */
+size_t
+ring_space (const struct ring *r) 
+{
+  return RING_BUFSIZE - ring_used (r);
+}
+
+/** Returns true if R is empty, false otherwise. */
+bool
+ring_empty (const struct ring *r) 
+{
+  return ring_used (r) == 0;
+}
+
+/** Returns true if R is full, false otherwise. */
+bool
+ring_full (const struct ring *r) 
+{
+  return ring_space (r) == 0;
+}
+
+/** Copies up to SIZE bytes from BUF to the end of R, as many as
+   fit, and returns the number copied.  Never sleeps.  Wakes the
+   consumer if it was waiting for data.  Must be called only by
+   the producer. */
+size_t
+ring_put (struct ring *r, const void *buf_, size_t size) 
+{
+  const uint8_t *buf = buf_;
+  unsigned head = r->head;
+  size_t ofs = head % RING_BUFSIZE;
+  size_t first;
+
+  if (size > ring_space (r))
+    size = ring_space (r);
+  if (size == 0)
+    return 0;
+
+  first = RING_BUFSIZE - ofs < size ? RING_BUFSIZE - ofs : size;
+  memcpy (r->buf + ofs, buf, first);
+  memcpy (r->buf, buf + first, size - first);
+
+  /* Publish the bytes only after they are in the buffer. */
+  barrier ();
+  r->head = head + size;
+  barrier ();
+
+  if (r->not_empty != NULL)
+    wake (&r->not_empty);
+  return size;
+}
+
+/** Copies up to SIZE bytes from the front of R into BUF, as many
+   as are available, and returns the number copied.  Never
+   sleeps.  Wakes the producer if it was waiting for space.  Must
+   be called only by the consumer. */
+size_t
+ring_get (struct ring *r, void *buf_, size_t size) 
+{
+  uint8_t *buf = buf_;
+  unsigned tail = r->tail;
+  size_t ofs = tail % RING_BUFSIZE;
+  size_t first;
+
+  if (size > ring_used (r))
+    size = ring_used (r);
+  if (size == 0)
+    return 0;
+
+  /* Read the bytes only after seeing them published. */
+  barrier ();
+  first = RING_BUFSIZE - ofs < size ? RING_BUFSIZE - ofs : size;
+  memcpy (buf, r->buf + ofs, first);
+  memcpy (buf + first, r->buf, size - first);
+
+  /* Release the space only after the bytes are copied out. */
+  barrier ();
+  r->tail = tail + size;
+  barrier ();
+
+  if (r->not_full != NULL)
+    wake (&r->not_full);
+  return size;
+}
+
+static bool
+has_data (const struct ring *r) 
+{
+  return !ring_empty (r);
+}
+
+static bool
+has_space (const struct ring *r) 
+{
+  return !ring_full (r);
+}
+
+/** Sleeps until R is not empty and returns true, or returns
+   false at once if another thread is already waiting for data.
+   Must be called only by the consumer, from a kernel thread. */
+bool
+ring_wait_data (struct ring *r) 
+{
+  return wait (r, &r->not_empty, has_data);
+}
+
+/** Sleeps until R is not full and returns true, or returns false
+   at once if another thread is already waiting for space.  Must
+   be called only by the producer, from a kernel thread. */
+bool
+ring_wait_space (struct ring *r) 
+{
+  return wait (r, &r->not_full, has_space);
+}
+
+/** Sleeps in *WAITER until READY(R) is true, then returns true.
+   The condition is checked again after *WAITER is set, with
+   interrupts off, so that the other side cannot change it unseen
+   in between: either it moved bytes before that check, or it
+   sees *WAITER and wakes us afterward.  Returns false without
+   sleeping if *WAITER is already taken by another thread. */
+static bool
+wait (struct ring *r, struct thread *volatile *waiter,
+      bool (*ready) (const struct ring *)) 
+{
+  enum intr_level old_level;
+  bool success = true;
+
+  ASSERT (!intr_context ());
+
+  if (ready (r))
+    return true;
+
+  old_level = intr_disable ();
+  while (!ready (r)) 
+    {
+      if (*waiter != NULL) 
+        {
+          success = false;
+          break;
+        }
+      *waiter = thread_current ();
+      thread_block ();
+    }
+  intr_set_level (old_level);
+  return success;
+}
+
+/** Wakes the thread in *WAITER, if any, and clears *WAITER. */
+static void
+wake (struct thread *volatile *waiter) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct thread *t = *waiter;
+
+  if (t != NULL) 
+    {
+      *waiter = NULL;
+      thread_unblock (t);
+    }
+  intr_set_level (old_level);
+}
@@ -0,0 +1,55 @@
+#ifndef DEVICES_RING_H
+#define DEVICES_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** A single-producer, single-consumer ring buffer of bytes,
+   shared between kernel threads and external interrupt
+   handlers.
+
+   One side of the ring only ever writes `head' and the other
+   only ever writes `tail', so, unlike the old interrupt queue,
+   neither side needs to turn interrupts off or take a lock to
+   move data, and either may be an interrupt handler.  Both
+   counters run freely and wrap around; the buffer position is
+   the counter modulo RING_BUFSIZE.  Data moves in batches:
+   ring_put() and ring_get() copy as many bytes as fit or are
+   available and return the count.
+
+   If more than one thread may produce, or more than one may
+   consume, the caller must serialize them, with a lock or by
+   turning interrupts off.  A thread, but not an interrupt
+   handler, may wait for data or space with ring_wait_data() or
+   ring_wait_space(); the other side wakes it after moving
+   bytes.  Only one thread at a time may wait on each side.  If
+   another is already waiting, these functions return false at
+   once, so that a caller that cannot serialize its waits can
+   fall back on something else, such as polling. */
+
+/** Buffer size, in bytes.  Must be a power of 2. */
+#define RING_BUFSIZE 256
+
+/** A ring buffer. */
+struct ring
+  {
+    uint8_t buf[RING_BUFSIZE];          /**< Buffer. */
+    volatile unsigned head;             /**< Bytes ever put; producer only. */
+    volatile unsigned tail;             /**< Bytes ever taken; consumer only. */
+    struct thread *volatile not_empty;  /**< Consumer waiting for data. */
+    struct thread *volatile not_full;   /**< Producer waiting for space. */
+  };
+
+void ring_init (struct ring *);
+size_t ring_used (const struct ring *);
+size_t ring_space (const struct ring *);
+bool ring_empty (const struct ring *);
+bool ring_full (const struct ring *);
+
+size_t ring_put (struct ring *, const void *, size_t);
+size_t ring_get (struct ring *, void *, size_t);
+bool ring_wait_data (struct ring *);
+bool ring_wait_space (struct ring *);
+
+#endif /**< devices/ring.h */
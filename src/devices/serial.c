@@ -1,10 +1,11 @@
 #include "devices/serial.h"
 #include <debug.h>
 #include "devices/input.h"
-#include "devices/intq.h"
+#include "devices/ring.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/rcu.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -37,6 +38,13 @@
 #define IER_RECV 0x01           /**< Interrupt when data received. */
 #define IER_XMIT 0x02           /**< Interrupt when transmit finishes. */
 
+/** FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /**< Enable FIFOs, receive trigger at 1 byte. */
+#define FCR_CLEAR 0x06          /**< Clear both FIFOs. */
+
+/** Bytes the transmit FIFO holds once THR is reported empty. */
+#define TX_FIFO_SIZE 16
+
 /** Line Control Register bits. */
 #define LCR_N81 0x03            /**< No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /**< Divisor Latch Access Bit (DLAB). */
@@ -51,8 +59,12 @@
 /** Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/** Data to be transmitted. */
-static struct intq txq;
+/** Data to be transmitted.  Producers run with interrupts off,
+   which serializes them; the interrupt handler consumes. */
+static struct ring txq;
+
+/** Last value written to the Interrupt Enable Register. */
+static uint8_t ier;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
@@ -68,10 +80,11 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /**< Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /**< Disable FIFO. */
+  ier = 0;
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR); /**< Enable and clear FIFOs. */
   set_serial (9600);                    /**< 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /**< Required to enable interrupts. */
-  intq_init (&txq);
+  ring_init (&txq);
   mode = POLL;
 } 
 
@@ -98,33 +111,66 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_write (&byte, 1);
+}
+
+/** Sends the SIZE bytes in BUF to the serial port.  Interrupts are
+   turned off once per batch of bytes queued, not once per
+   byte. */
+void
+serial_write (const void *buf_, size_t size) 
+{
+  const uint8_t *buf = buf_;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (size-- > 0)
+        putc_poll (*buf++); 
     }
   else 
-    {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
-        {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
-        }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
-    }
+    while (size > 0)
+      {
+        /* Queue as much as fits and update the interrupt enable
+           register. */
+        size_t queued = ring_put (&txq, buf, size);
+        uint8_t byte;
+
+        buf += queued;
+        size -= queued;
+        write_ier ();
+        if (size == 0)
+          break;
+
+        /* Wait for the transmit queue to drain, unless another
+           thread is waiting for it already.  Callers outside the
+           console lock, such as the panic and debug paths, can
+           make that happen.  An RCU reader may not sleep, so it
+           does not wait either. */
+        if (old_level == INTR_ON && !rcu_read_lock_held ()) 
+          {
+            bool waited;
+
+            intr_set_level (old_level);
+            waited = ring_wait_space (&txq);
+            intr_disable ();
+            if (waited)
+              continue;
+          }
+
+        /* Interrupts are off, the caller may not sleep, or
+           another thread is waiting, and the transmit queue is
+           full.  If we wanted to wait for
+           the queue to empty, we'd have to reenable interrupts or
+           wait behind the other thread.  That's impolite, so
+           we'll send a character via polling instead. */
+        if (ring_get (&txq, &byte, 1) > 0)
+          putc_poll (byte); 
+      }
   
   intr_set_level (old_level);
 }
@@ -135,8 +181,10 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  uint8_t byte;
+
+  while (ring_get (&txq, &byte, 1) > 0)
+    putc_poll (byte);
   intr_set_level (old_level);
 }
 
@@ -172,25 +220,29 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
-/** Update interrupt enable register. */
+/** Update interrupt enable register, if its value changes. */
 static void
 write_ier (void) 
 {
-  uint8_t ier = 0;
+  uint8_t new_ier = 0;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
-    ier |= IER_XMIT;
+  if (!ring_empty (&txq))
+    new_ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
      characters we receive. */
   if (!input_full ())
-    ier |= IER_RECV;
+    new_ier |= IER_RECV;
   
-  outb (IER_REG, ier);
+  if (new_ier != ier) 
+    {
+      ier = new_ier;
+      outb (IER_REG, ier);
+    }
 }
 
 /** Polls the serial port until it's ready,
@@ -209,19 +261,34 @@ putc_poll (uint8_t byte)
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
 {
+  uint8_t bytes[TX_FIFO_SIZE];
+  size_t room, cnt, i;
+
   /* Inquire about interrupt in UART.  Without this, we can
      occasionally miss an interrupt running under QEMU. */
   inb (IIR_REG);
 
-  /* As long as we have room to receive a byte, and the hardware
-     has a byte for us, receive a byte.  */
-  while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
-    input_putc (inb (RBR_REG));
+  /* As long as we have room to receive bytes, and the hardware
+     has bytes for us, receive them a batch at a time. */
+  do 
+    {
+      room = input_space ();
+      if (room > sizeof bytes)
+        room = sizeof bytes;
+      for (cnt = 0; cnt < room && (inb (LSR_REG) & LSR_DR) != 0; cnt++)
+        bytes[cnt] = inb (RBR_REG);
+      input_putbuf (bytes, cnt);
+    }
+  while (cnt == sizeof bytes);
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* Once the hardware has emptied its transmit FIFO, refill it
+     with up to a FIFO's worth of bytes. */
+  if ((inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      cnt = ring_get (&txq, bytes, sizeof bytes);
+      for (i = 0; i < cnt; i++)
+        outb (THR_REG, bytes[i]);
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
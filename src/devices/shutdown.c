@@ -5,6 +5,10 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/memtag.h"
+#include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -130,6 +134,11 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  lock_print_stats ();
+  palloc_print_stats ();
+  kmem_print_stats ();
+  memtag_print_stats ();
+  shrinker_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
@@ -4,6 +4,7 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "devices/tsc.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
@@ -19,7 +20,63 @@
 /** Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-static struct list sema_timer_list;
+/** Sleeping threads wait in a hierarchical timing wheel.  Level
+   L has TIMER_WHEEL_SIZE slots that each cover
+   TIMER_WHEEL_SIZE**L ticks.  A sleeper due within
+   TIMER_WHEEL_SIZE ticks sits in the level 0 slot for its exact
+   wakeup tick; later sleepers sit in a coarser slot and drop
+   down a level each time the level below wraps around.  Sleepers
+   due beyond the top level's range wait in wheel_overflow.  A
+   tick with nothing due thus costs O(1), and waking sleepers
+   costs O(1) each. */
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SIZE (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS 4
+
+static struct list timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static struct list wheel_overflow;
+
+/** Next tick whose level 0 slot has not run yet. */
+static int64_t wheel_ticks;
+
+/** Timer interrupt handler cost, in TSC cycles. */
+static struct timer_irq_stats irq_stats;
+
+/** If false (default), the PIT interrupts TIMER_FREQ times per
+   second all the time.  If true, the idle thread reprograms it
+   to interrupt once, at the next tick that has work to do, and
+   the skipped ticks are caught up afterward.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/** PIT cycles in one timer tick, and the most ticks that fit in
+   a single 16-bit one-shot countdown. */
+#define PIT_COUNTS_PER_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (UINT16_MAX / PIT_COUNTS_PER_TICK)
+
+/** State of the one-shot countdown started by timer_idle_enter(). */
+static bool oneshot_armed;      /**< Periodic tick is stopped. */
+static int64_t oneshot_ticks;   /**< Ticks until the countdown ends. */
+static unsigned oneshot_count;  /**< PIT cycles programmed. */
+static unsigned oneshot_phase;  /**< PIT cycles into the tick at start. */
+
+/** Ticks that passed during a countdown cut short by another
+   interrupt, to be caught up at the next timer interrupt, and
+   PIT cycles left over that did not make up a whole tick. */
+static int64_t tickless_lost;
+static unsigned tickless_residue;
+
+/** Nanoseconds in one timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/** High-resolution sleepers, in order of expiry time.  While the
+   first one is due before the next tick, the PIT counts down to
+   it in mode 0 instead of running periodically, and then counts
+   down the rest of the tick.  See hrtimer_program(). */
+static struct list hrtimer_list;
+static bool hr_armed;           /**< Counting down to an hrtimer. */
+static unsigned hr_tick_left;   /**< PIT cycles from then to the tick. */
 
 /** Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -36,18 +93,36 @@ static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
 
 static void sema_timer_init(int64_t start, int64_t sleep, struct sema_timer *pst);
-static void check_sema_timers();
+static void wheel_insert(struct sema_timer *);
+static void wheel_cascade(struct list *);
+static void wheel_advance(void);
+static int64_t tickless_catch_up(void);
+static bool hrtimer_less(const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void hrtimer_expire(void);
+static void hrtimer_program(unsigned tick_left, bool periodic);
+static void hrtimer_reprogram(void);
+static unsigned periodic_remaining(void);
+
 /** Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init(void)
 {
+    int level, slot;
+
     pit_configure_channel(0, 2, TIMER_FREQ);
     intr_register_ext(0x20, timer_interrupt, "8254 Timer");
-    list_init(&sema_timer_list);
+    intr_register_softirq(SOFTIRQ_TIMER, wheel_advance);
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+        for (slot = 0; slot < TIMER_WHEEL_SIZE; slot++)
+            list_init(&timer_wheel[level][slot]);
+    list_init(&wheel_overflow);
+    list_init(&hrtimer_list);
 }
 
-/** Calibrates loops_per_tick, used to implement brief delays. */
+/** Calibrates loops_per_tick, used to implement brief delays,
+   and the TSC clocksource behind timer_ns(). */
 void
 timer_calibrate(void) {
     unsigned high_bit, test_bit;
@@ -69,9 +144,13 @@ timer_calibrate(void) {
         if (!too_many_loops(high_bit | test_bit))
             loops_per_tick |= test_bit;
 
+    tsc_calibrate();
+
     printf("%'"
     PRIu64
-    " loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+    " loops/s, %'"
+    PRIu64
+    " TSC cycles/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz());
 }
 
 /** Returns the number of timer ticks since the OS booted. */
@@ -83,6 +162,16 @@ timer_ticks(void) {
     return t;
 }
 
+/** Returns the number of nanoseconds since the OS booted.  After
+   timer_calibrate() this reads the TSC, so it is cheap and has
+   sub-tick resolution; before, it only counts whole ticks. */
+int64_t
+timer_ns(void) {
+    if (!tsc_calibrated())
+        return timer_ticks() * NS_PER_TICK;
+    return tsc_ns();
+}
+
 /** Returns the number of timer ticks elapsed since THEN, which
    should be a value once returned by timer_ticks(). */
 int64_t
@@ -94,22 +183,47 @@ timer_elapsed(int64_t then) {
    be turned on. */
 void
 timer_sleep(int64_t ticks) {
-
     int64_t start = timer_ticks();
-    enum intr_level old_level = intr_disable();
-    if(ticks<=0) return;
+    enum intr_level old_level;
     struct sema_timer st;
 
+    if (ticks <= 0)
+        return;
+
     sema_timer_init(start, ticks, &st);
-    list_push_back(&sema_timer_list, &st.elem);
+    old_level = intr_disable();
+    wheel_insert(&st);
     sema_down(&st.semaphore);
     intr_set_level(old_level);
-    /*
+}
+
+/** Sleeps for approximately NS nanoseconds, with sub-tick
+   resolution, yielding the CPU to other threads.  The PIT is
+   reprogrammed to interrupt when the earliest such sleeper is
+   due.  Interrupts must be turned on. */
+void
+timer_hrsleep(int64_t ns) {
+    struct hrtimer h;
+    enum intr_level old_level;
+
     ASSERT(intr_get_level() == INTR_ON);
-    while (timer_elapsed (start) < ticks)
-      thread_yield ();
-    */
 
+    if (ns <= 0)
+        return;
+    if (!tsc_calibrated()) {
+        real_time_delay(ns, 1000 * 1000 * 1000);
+        return;
+    }
+
+    h.expires = timer_ns() + ns;
+    sema_init(&h.semaphore, 0);
+
+    old_level = intr_disable();
+    list_insert_ordered(&hrtimer_list, &h.elem, hrtimer_less, NULL);
+    if (list_front(&hrtimer_list) == &h.elem)
+        hrtimer_reprogram();
+    sema_down(&h.semaphore);
+    intr_set_level(old_level);
 }
 
 /** Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -177,29 +291,341 @@ timer_print_stats(void) {
     " ticks\n", timer_ticks());
 }
 
+/** Stores the timer interrupt handler's cost since boot or the
+   last timer_irq_stats_reset() into STATS. */
+void
+timer_irq_stats(struct timer_irq_stats *stats) {
+    enum intr_level old_level = intr_disable();
+    *stats = irq_stats;
+    intr_set_level(old_level);
+}
+
+/** Clears the timer interrupt handler statistics. */
+void
+timer_irq_stats_reset(void) {
+    enum intr_level old_level = intr_disable();
+    irq_stats.ticks = 0;
+    irq_stats.wakeups = 0;
+    irq_stats.total_cycles = 0;
+    irq_stats.max_cycles = 0;
+    intr_set_level(old_level);
+}
+
 /** Timer interrupt handler. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED) {
-    ticks++;
-    check_sema_timers();
-    thread_tick();
-}
-
-static void check_sema_timers(){
-    struct list_elem *e;
-    struct list_elem *ne;
-    for (e = list_begin(&sema_timer_list); e != list_end(&sema_timer_list); e = ne)
-    {
-        ne = list_next (e);
-        struct sema_timer *st = list_entry (e, struct sema_timer, elem);
-        if(ticks >= st->start + st->sleep){
-            list_remove(e);
+    uint64_t start = tsc_read();
+    uint64_t cycles;
+
+    if (hr_armed) {
+        /* A countdown to an hrtimer ended within the tick. */
+        hr_armed = false;
+        hrtimer_expire();
+        hrtimer_program(hr_tick_left, false);
+    } else {
+        int64_t skipped = tickless_catch_up();
+
+        /* Replay the ticks that passed without an interrupt. */
+        while (skipped-- > 0) {
+            ticks++;
+            thread_idle_tick();
+        }
+
+        ticks++;
+        thread_tick();
+
+        /* Wake sleepers after the interrupt is acknowledged. */
+        if (wheel_ticks <= ticks)
+            intr_raise_softirq(SOFTIRQ_TIMER);
+
+        hrtimer_expire();
+        if (!list_empty(&hrtimer_list))
+            hrtimer_program(periodic_remaining(), true);
+    }
+
+    cycles = tsc_read() - start;
+    irq_stats.ticks++;
+    irq_stats.total_cycles += cycles;
+    if (cycles > irq_stats.max_cycles)
+        irq_stats.max_cycles = cycles;
+}
+
+/** Files ST in the timing wheel slot for its wakeup tick.
+   Interrupts must be off. */
+static void
+wheel_insert(struct sema_timer *st) {
+    int64_t expires = st->start + st->sleep;
+    int64_t delta;
+    int level;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    /* A sleeper that is already due wakes on the next tick. */
+    if (expires < wheel_ticks)
+        expires = wheel_ticks;
+    delta = expires - wheel_ticks;
+
+    for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+        if (delta < (int64_t) 1 << (TIMER_WHEEL_BITS * (level + 1))) {
+            int slot = (expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+            list_push_back(&timer_wheel[level][slot], &st->elem);
+            return;
+        }
+    list_push_back(&wheel_overflow, &st->elem);
+}
+
+/** Empties SLOT and refiles each of its sleepers relative to the
+   current wheel position, which moves them down a level. */
+static void
+wheel_cascade(struct list *slot) {
+    struct list pending;
+
+    if (list_empty(slot))
+        return;
+    list_init(&pending);
+    list_splice(list_end(&pending), list_begin(slot), list_end(slot));
+    while (!list_empty(&pending))
+        wheel_insert(list_entry(list_pop_front(&pending), struct sema_timer, elem));
+}
+
+/** Runs the timing wheel up to the current tick, waking every
+   sleeper that is due.  Runs as the timer softirq, with
+   interrupts turned off one tick at a time, so a long cascade
+   does not hold off other interrupts. */
+static void
+wheel_advance(void) {
+    for (;;) {
+        enum intr_level old_level = intr_disable();
+        int index = wheel_ticks & TIMER_WHEEL_MASK;
+        struct list *slot = &timer_wheel[0][index];
+
+        if (wheel_ticks > ticks) {
+            intr_set_level(old_level);
+            break;
+        }
+
+        /* Level 0 wrapped around: pull the next coarser slot down,
+           and so on up the levels. */
+        if (index == 0) {
+            int level;
+
+            for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                int upper = (wheel_ticks >> (TIMER_WHEEL_BITS * level))
+                            & TIMER_WHEEL_MASK;
+                wheel_cascade(&timer_wheel[level][upper]);
+                if (upper != 0)
+                    break;
+            }
+            if (level == TIMER_WHEEL_LEVELS)
+                wheel_cascade(&wheel_overflow);
+        }
+        wheel_ticks++;
+
+        while (!list_empty(slot)) {
+            struct sema_timer *st = list_entry(list_pop_front(slot),
+                                               struct sema_timer, elem);
+            irq_stats.wakeups++;
             sema_up(&st->semaphore);
-            //intr_yield_on_return();
         }
+        intr_set_level(old_level);
+    }
+}
+
+/** Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick by
+   a single PIT countdown that ends at the next tick that has a
+   sleeper to wake or a timing wheel level to cascade, up to
+   TICKLESS_MAX_TICKS away.  The countdown includes what is left
+   of the current tick, so the tick phase is kept. */
+void
+timer_idle_enter(void) {
+    int64_t next, limit;
+    unsigned remaining;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!timer_tickless || oneshot_armed || hr_armed || tickless_lost != 0)
+        return;
+
+    /* Wake up no later than the tick before the first hrtimer is
+       due, so that the tick can arm its countdown. */
+    limit = ticks + TICKLESS_MAX_TICKS;
+    if (!list_empty(&hrtimer_list)) {
+        struct hrtimer *h = list_entry(list_front(&hrtimer_list),
+                                       struct hrtimer, elem);
+        int64_t delta = h->expires - timer_ns();
+        int64_t hr_limit = ticks + (delta > 0 ? delta / NS_PER_TICK : 0);
+
+        if (hr_limit < limit)
+            limit = hr_limit;
+    }
+
+    for (next = wheel_ticks; next < limit; next++)
+        if ((next & TIMER_WHEEL_MASK) == 0
+            || !list_empty(&timer_wheel[0][next & TIMER_WHEEL_MASK]))
+            break;
+    if (next - ticks <= 1)
+        return;
+
+    remaining = pit_read_counter(0, NULL);
+    if (remaining == 0 || remaining > PIT_COUNTS_PER_TICK)
+        return;
+
+    oneshot_ticks = next - ticks;
+    oneshot_phase = PIT_COUNTS_PER_TICK - remaining;
+    oneshot_count = remaining + (oneshot_ticks - 1) * PIT_COUNTS_PER_TICK;
+    oneshot_armed = true;
+    pit_start_oneshot(0, oneshot_count);
+}
+
+/** Called with interrupts off whenever the idle thread gives up
+   the CPU.  If another interrupt cut a countdown short, restores
+   the periodic tick and leaves the whole ticks that passed for
+   the next timer interrupt to catch up. */
+void
+timer_idle_exit(void) {
+    bool expired;
+    unsigned remaining, elapsed;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!oneshot_armed)
+        return;
+
+    /* If the countdown already ran out, its interrupt is pending
+       and will do the catching up. */
+    remaining = pit_read_counter(0, &expired);
+    if (expired)
+        return;
+
+    oneshot_armed = false;
+    pit_configure_channel(0, 2, TIMER_FREQ);
+    elapsed = oneshot_phase + (oneshot_count - remaining) + tickless_residue;
+    tickless_lost = elapsed / PIT_COUNTS_PER_TICK;
+    tickless_residue = elapsed % PIT_COUNTS_PER_TICK;
+}
+
+/** Called on each timer interrupt.  Restores the periodic tick if
+   this interrupt ended a countdown, and returns the number of
+   ticks before this one that passed without an interrupt. */
+static int64_t
+tickless_catch_up(void) {
+    int64_t skipped = tickless_lost;
+
+    tickless_lost = 0;
+    if (oneshot_armed) {
+        oneshot_armed = false;
+        pit_configure_channel(0, 2, TIMER_FREQ);
+        skipped = oneshot_ticks - 1;
+    }
+    return skipped;
+}
+
+/** Orders hrtimers by expiry time. */
+static bool
+hrtimer_less(const struct list_elem *a, const struct list_elem *b,
+             void *aux UNUSED) {
+    return list_entry(a, struct hrtimer, elem)->expires
+           < list_entry(b, struct hrtimer, elem)->expires;
+}
+
+/** Wakes every high-resolution sleeper that is due. */
+static void
+hrtimer_expire(void) {
+    int64_t now = timer_ns();
+
+    while (!list_empty(&hrtimer_list)) {
+        struct hrtimer *h = list_entry(list_front(&hrtimer_list),
+                                       struct hrtimer, elem);
+        if (h->expires > now)
+            break;
+        list_pop_front(&hrtimer_list);
+        sema_up(&h->semaphore);
+    }
+}
+
+/** Programs the PIT for the rest of the current tick, which is
+   TICK_LEFT PIT cycles long.  If the first hrtimer is due before
+   the tick ends, counts down to it.  Otherwise, if the PIT is not
+   PERIODIC, counts down to the end of the tick, where the timer
+   interrupt will restore the periodic tick.  Interrupts must be
+   off. */
+static void
+hrtimer_program(unsigned tick_left, bool periodic) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(tick_left != 0);
+
+    if (!list_empty(&hrtimer_list)) {
+        struct hrtimer *h = list_entry(list_front(&hrtimer_list),
+                                       struct hrtimer, elem);
+        int64_t delta = h->expires - timer_ns();
+        unsigned count = tick_left;
+
+        /* Round up, so that the countdown never ends early. */
+        if (delta <= 0)
+            count = 1;
+        else if (delta < NS_PER_TICK)
+            count = (delta * PIT_HZ + 999999999) / 1000000000;
+        if (count < tick_left) {
+            hr_armed = true;
+            hr_tick_left = tick_left - count;
+            pit_start_oneshot(0, count);
+            return;
+        }
+    }
+
+    if (!periodic) {
+        oneshot_armed = true;
+        oneshot_ticks = 1;
+        oneshot_count = tick_left;
+        oneshot_phase = PIT_COUNTS_PER_TICK - tick_left;
+        pit_start_oneshot(0, tick_left);
     }
 }
 
+/** Called when a new hrtimer became the first one.  Moves the
+   current countdown, if any, earlier to match.  A countdown that
+   already ran out is left alone, because its pending interrupt
+   will reprogram the PIT. */
+static void
+hrtimer_reprogram(void) {
+    unsigned remaining;
+    bool expired;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (hr_armed) {
+        remaining = pit_read_counter(0, &expired);
+        if (expired)
+            return;
+        hr_armed = false;
+        hrtimer_program(remaining + hr_tick_left, false);
+    } else if (oneshot_armed) {
+        /* A countdown over several idle ticks ends at a tick,
+           which will arm the hrtimer. */
+        if (oneshot_ticks != 1)
+            return;
+        remaining = pit_read_counter(0, &expired);
+        if (expired)
+            return;
+        oneshot_armed = false;
+        hrtimer_program(remaining, false);
+    } else
+        hrtimer_program(periodic_remaining(), true);
+}
+
+/** Returns the PIT cycles left in the current tick while the PIT
+   runs periodically.  Right after the PIT is reprogrammed, the
+   counter may not hold a valid count yet; assume a full tick. */
+static unsigned
+periodic_remaining(void) {
+    unsigned remaining = pit_read_counter(0, NULL);
+
+    if (remaining == 0 || remaining > PIT_COUNTS_PER_TICK)
+        remaining = PIT_COUNTS_PER_TICK;
+    return remaining;
+}
+
 /** Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -252,9 +678,12 @@ real_time_sleep(int64_t num, int32_t denom) {
            timer_sleep() because it will yield the CPU to other
            processes. */
         timer_sleep(ticks);
+    } else if (tsc_calibrated()) {
+        /* Otherwise, block on a high-resolution timer for more
+           accurate sub-tick timing. */
+        timer_hrsleep(num * 1000000000 / denom);
     } else {
-        /* Otherwise, use a busy-wait loop for more accurate
-           sub-tick timing. */
+        /* Before calibration, fall back to a busy-wait loop. */
         real_time_delay(num, denom);
     }
 }
@@ -275,10 +704,3 @@ sema_timer_init(int64_t start, int64_t sleep, struct sema_timer *pst) {
     pst->start = start;
     sema_init(&pst->semaphore, 0);
 }
-
-bool list_timer_less(const struct list_elem *a,
-                             const struct list_elem *b,
-                             void *aux){
-    return (list_entry(a,struct sema_timer,elem)->start + list_entry(a,struct sema_timer,elem)->sleep) <=
-            (list_entry(b,struct sema_timer,elem)->start + list_entry(b,struct sema_timer,elem)->sleep);
-}
\ No newline at end of file
@@ -14,12 +14,14 @@ void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
 
 /** Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+void timer_hrsleep (int64_t nanoseconds);
 
 /** Busy waits. */
 void timer_mdelay (int64_t milliseconds);
@@ -28,6 +30,25 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/** If true, the idle thread stops the periodic tick.
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
+/** Timer interrupt handler cost, measured with the TSC. */
+struct timer_irq_stats
+  {
+    int64_t ticks;              /**< Timer interrupts handled. */
+    int64_t wakeups;            /**< Sleepers woken. */
+    uint64_t total_cycles;      /**< Cycles spent in the handler. */
+    uint64_t max_cycles;        /**< Longest single interrupt. */
+  };
+
+void timer_irq_stats (struct timer_irq_stats *);
+void timer_irq_stats_reset (void);
+
 struct sema_timer{
     int64_t start;
     int64_t sleep;
@@ -35,8 +56,12 @@ struct sema_timer{
     struct list_elem elem;
 };
 
-bool list_timer_less(const struct list_elem *a,
-                     const struct list_elem *b,
-                     void *aux);
+/** A thread blocked in timer_hrsleep(). */
+struct hrtimer
+  {
+    int64_t expires;            /**< Wakeup time, per timer_ns(). */
+    struct semaphore semaphore; /**< Upped on expiry. */
+    struct list_elem elem;      /**< Element in the hrtimer list. */
+  };
 
 #endif /**< devices/timer.h */
@@ -0,0 +1,111 @@
+#include "devices/tsc.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/** Monotonic clocksource based on the CPU's time-stamp counter
+   (TSC), which counts at a fixed rate that we measure against
+   the PIT-driven timer tick.
+
+   Converting TSC cycles to nanoseconds uses a fixed-point
+   multiplier, ns = cycles * mult >> shift, so that reading the
+   clock costs one `rdtsc' and a couple of 32-bit multiplies,
+   with no 64-bit division. */
+
+/** Number of timer ticks to measure the TSC over. */
+#define CALIBRATION_TICKS 4
+
+static bool calibrated;         /**< Set once tsc_calibrate() is done. */
+static uint64_t cycles_per_sec; /**< Measured TSC frequency. */
+static uint64_t base_cycles;    /**< TSC value at BASE_NS. */
+static int64_t base_ns;         /**< Time since boot at BASE_CYCLES. */
+static uint32_t mult;           /**< Cycles to ns multiplier... */
+static unsigned shift;          /**< ...and shift. */
+
+/** Returns A * MUL >> SHIFT, for SHIFT <= 32, without losing the
+   high bits of the 96-bit product. */
+static inline uint64_t
+mul_u64_u32_shr (uint64_t a, uint32_t mul, unsigned shift)
+{
+  uint32_t high = a >> 32;
+  uint32_t low = a;
+  uint64_t result = ((uint64_t) low * mul) >> shift;
+
+  if (high != 0)
+    result += ((uint64_t) high * mul) << (32 - shift);
+  return result;
+}
+
+/** Waits for the start of a timer tick and returns its number. */
+static int64_t
+wait_for_tick (void)
+{
+  int64_t start = timer_ticks ();
+  int64_t now;
+
+  while ((now = timer_ticks ()) == start)
+    barrier ();
+  return now;
+}
+
+/** Measures the TSC frequency against the timer tick and sets up
+   the cycles to nanoseconds conversion.  Interrupts must be on. */
+void
+tsc_calibrate (void)
+{
+  int64_t start_tick;
+  uint64_t start, end;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  start_tick = wait_for_tick ();
+  start = tsc_read ();
+  while (timer_ticks () - start_tick < CALIBRATION_TICKS)
+    barrier ();
+  end = tsc_read ();
+
+  cycles_per_sec = (end - start) * TIMER_FREQ / CALIBRATION_TICKS;
+  ASSERT (cycles_per_sec != 0);
+
+  /* Use the largest shift whose multiplier still fits in 32 bits,
+     for the most precision. */
+  for (shift = 32; shift > 0; shift--)
+    {
+      uint64_t m = (1000000000ULL << shift) / cycles_per_sec;
+      if (m <= UINT32_MAX)
+        {
+          mult = m;
+          break;
+        }
+    }
+  ASSERT (shift > 0);
+
+  base_cycles = start;
+  base_ns = start_tick * (1000000000 / TIMER_FREQ);
+  calibrated = true;
+}
+
+/** Returns true once tsc_calibrate() has run. */
+bool
+tsc_calibrated (void)
+{
+  return calibrated;
+}
+
+/** Returns the measured TSC frequency in Hz, or 0 before
+   calibration. */
+uint64_t
+tsc_hz (void)
+{
+  return cycles_per_sec;
+}
+
+/** Returns the number of nanoseconds since the OS booted.  Must
+   not be called before tsc_calibrate(). */
+int64_t
+tsc_ns (void)
+{
+  ASSERT (calibrated);
+  return base_ns + mul_u64_u32_shr (tsc_read () - base_cycles, mult, shift);
+}
@@ -0,0 +1,21 @@
+#ifndef DEVICES_TSC_H
+#define DEVICES_TSC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Returns the CPU's time-stamp counter. */
+static inline uint64_t
+tsc_read (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+void tsc_calibrate (void);
+bool tsc_calibrated (void);
+uint64_t tsc_hz (void);
+int64_t tsc_ns (void);
+
+#endif /**< devices/tsc.h */
@@ -13,6 +13,8 @@
 
 struct inode;
 
+void dir_init (void);
+
 /** Opening and closing directories. */
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
@@ -42,7 +42,7 @@ fsutil_cat (char **argv)
   file = filesys_open (file_name);
   if (file == NULL)
     PANIC ("%s: open failed", file_name);
-  buffer = palloc_get_page (PAL_ASSERT);
+  buffer = palloc_get_page (PAL_ASSERT | PAL_TAG (MEM_BUFFER));
   for (;;) 
     {
       off_t pos = file_tell (file);
@@ -78,8 +78,8 @@ fsutil_extract (char **argv UNUSED)
   void *header, *data;
 
   /* Allocate buffers. */
-  header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  header = malloc_tagged (BLOCK_SECTOR_SIZE, MEM_BUFFER);
+  data = malloc_tagged (BLOCK_SECTOR_SIZE, MEM_BUFFER);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -177,7 +177,7 @@ fsutil_append (char **argv)
   printf ("Appending '%s' to ustar archive on scratch device...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (BLOCK_SECTOR_SIZE);
+  buffer = malloc_tagged (BLOCK_SECTOR_SIZE, MEM_BUFFER);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
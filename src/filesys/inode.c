@@ -5,7 +5,10 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
-#include "threads/malloc.h"
+#include "threads/interrupt.h"
+#include "threads/rcu.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 
 /** Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -37,6 +40,7 @@ struct inode
     bool removed;                       /**< True if deleted, false otherwise. */
     int deny_write_cnt;                 /**< 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /**< Inode content. */
+    struct rcu_head rcu;                /**< Deferred free after close. */
   };
 
 /** Returns the block device sector that contains byte offset POS
@@ -54,14 +58,67 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /** List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Lookups walk it under
+   rcu_read_lock(); changes hold open_inodes_lock, and a closed
+   inode is freed only after an RCU grace period. */
 static struct list open_inodes;
+static struct lock open_inodes_lock;
+
+/** Caches for in-memory inodes and for sector-sized buffers. */
+static struct kmem_cache inode_cache;
+static struct kmem_cache sector_cache;
 
 /** Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
+  lock_set_name (&open_inodes_lock, "open inodes");
+  kmem_cache_init (&inode_cache, "inode", sizeof (struct inode), NULL,
+                   MEM_INODE);
+  kmem_cache_init (&sector_cache, "sector", BLOCK_SECTOR_SIZE, NULL,
+                   MEM_BUFFER);
+}
+
+/** Returns the open inode for SECTOR, or a null pointer if there
+   is none.  The caller must be in an RCU read-side critical
+   section or hold open_inodes_lock. */
+static struct inode *
+open_inodes_find (block_sector_t sector) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode;
+    }
+  return NULL;
+}
+
+/** Takes a reference to INODE, unless its last opener has
+   already closed it.  Returns true if successful. */
+static bool
+inode_get (struct inode *inode) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool live = inode->open_cnt > 0;
+
+  if (live)
+    inode->open_cnt++;
+  intr_set_level (old_level);
+  return live;
+}
+
+/** Frees an inode once no reader can still see it. */
+static void
+inode_free (struct rcu_head *head) 
+{
+  kmem_cache_free (&inode_cache,
+                   list_entry (&head->elem, struct inode, rcu.elem));
 }
 
 /** Initializes an inode with LENGTH bytes of data and
@@ -81,10 +138,11 @@ inode_create (block_sector_t sector, off_t length)
      one sector in size, and you should fix that. */
   ASSERT (sizeof *disk_inode == BLOCK_SECTOR_SIZE);
 
-  disk_inode = calloc (1, sizeof *disk_inode);
+  disk_inode = kmem_cache_alloc (&sector_cache);
   if (disk_inode != NULL)
     {
       size_t sectors = bytes_to_sectors (length);
+      memset (disk_inode, 0, sizeof *disk_inode);
       disk_inode->length = length;
       disk_inode->magic = INODE_MAGIC;
       if (free_map_allocate (sectors, &disk_inode->start)) 
@@ -100,7 +158,7 @@ inode_create (block_sector_t sector, off_t length)
             }
           success = true; 
         } 
-      free (disk_inode);
+      kmem_cache_free (&sector_cache, disk_inode);
     }
   return success;
 }
@@ -111,33 +169,41 @@ inode_create (block_sector_t sector, off_t length)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
-  struct inode *inode;
+  struct inode *inode, *found;
 
-  /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
-    {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
-    }
+  /* Check whether this inode is already open, without locking. */
+  rcu_read_lock ();
+  found = open_inodes_find (sector);
+  if (found != NULL && !inode_get (found))
+    found = NULL;
+  rcu_read_unlock ();
+  if (found != NULL)
+    return found;
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (&inode_cache);
   if (inode == NULL)
     return NULL;
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
+
+  /* Publish it, unless another thread opened the same inode while
+     we were reading it. */
+  lock_acquire (&open_inodes_lock);
+  found = open_inodes_find (sector);
+  if (found != NULL && inode_get (found)) 
+    {
+      lock_release (&open_inodes_lock);
+      kmem_cache_free (&inode_cache, inode);
+      return found;
+    }
+  rcu_list_insert (list_begin (&open_inodes), &inode->elem);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -145,8 +211,12 @@ inode_open (block_sector_t sector)
 struct inode *
 inode_reopen (struct inode *inode)
 {
-  if (inode != NULL)
-    inode->open_cnt++;
+  if (inode != NULL) 
+    {
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -163,15 +233,24 @@ inode_get_inumber (const struct inode *inode)
 void
 inode_close (struct inode *inode) 
 {
+  enum intr_level old_level;
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  old_level = intr_disable ();
+  last = --inode->open_cnt == 0;
+  intr_set_level (old_level);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
       /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      lock_acquire (&open_inodes_lock);
+      rcu_list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -181,7 +260,8 @@ inode_close (struct inode *inode)
                             bytes_to_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      /* Readers that found it just before may still look at it. */
+      call_rcu (&inode->rcu, inode_free); 
     }
 }
 
@@ -231,7 +311,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
              into caller's buffer. */
           if (bounce == NULL) 
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
+              bounce = kmem_cache_alloc (&sector_cache);
               if (bounce == NULL)
                 break;
             }
@@ -244,7 +324,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  kmem_cache_free (&sector_cache, bounce);
 
   return bytes_read;
 }
@@ -291,7 +371,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           /* We need a bounce buffer. */
           if (bounce == NULL) 
             {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
+              bounce = kmem_cache_alloc (&sector_cache);
               if (bounce == NULL)
                 break;
             }
@@ -312,7 +392,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+  kmem_cache_free (&sector_cache, bounce);
 
   return bytes_written;
 }
@@ -23,11 +23,21 @@ typedef unsigned long elem_type;
 
 /** From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   A bitmap may also have a summary level, added with
+   bitmap_add_summary(), with one bit per element of `bits' that
+   is set when every bit in that element is true.  Searches for
+   false bits use it to skip whole runs of full elements at once.
+
+   `hint' is where bitmap_scan_and_flip_next() starts looking,
+   just past the group it last returned. */
 struct bitmap
   {
     size_t bit_cnt;     /**< Number of bits. */
     elem_type *bits;    /**< Elements that represent bits. */
+    elem_type *full;    /**< Summary of full elements, or null. */
+    size_t hint;        /**< Next-fit search cursor. */
   };
 
 /** Returns the index of the element that contains the bit
@@ -68,6 +78,59 @@ last_mask (const struct bitmap *b)
   int last_bits = b->bit_cnt % ELEM_BITS;
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
+
+/** Returns a mask with bits LO through HI - 1 set, for
+   0 <= LO < ELEM_BITS and LO <= HI <= ELEM_BITS. */
+static inline elem_type
+range_mask (size_t lo, size_t hi) 
+{
+  elem_type below_hi = (hi < ELEM_BITS
+                        ? ((elem_type) 1 << hi) - 1 : (elem_type) -1);
+  return below_hi & ~(((elem_type) 1 << lo) - 1);
+}
+
+/** Returns the number of set bits in X. */
+static inline size_t
+popcount (elem_type x) 
+{
+  size_t cnt = 0;
+
+  for (; x != 0; x &= x - 1)
+    cnt++;
+  return cnt;
+}
+
+/** Returns the index of the lowest set bit in X, which must be
+   nonzero. */
+static inline size_t
+lowest_bit (elem_type x) 
+{
+  return __builtin_ctzl (x);
+}
+
+/** Returns the number of consecutive set bits at the top of X. */
+static inline size_t
+leading_ones (elem_type x) 
+{
+  return ~x != 0 ? (size_t) __builtin_clzl (~x) : ELEM_BITS;
+}
+
+/** Recomputes the summary bit for element ELEM of B, if B has a
+   summary.  The summary is not updated atomically with the
+   element itself. */
+static inline void
+update_summary (struct bitmap *b, size_t elem) 
+{
+  if (b->full != NULL) 
+    {
+      elem_type used = (elem == elem_cnt (b->bit_cnt) - 1
+                        ? last_mask (b) : (elem_type) -1);
+      if ((b->bits[elem] & used) == used)
+        b->full[elem_idx (elem)] |= bit_mask (elem);
+      else
+        b->full[elem_idx (elem)] &= ~bit_mask (elem);
+    }
+}
 
 /** Creation and destruction. */
 
@@ -83,6 +146,8 @@ bitmap_create (size_t bit_cnt)
     {
       b->bit_cnt = bit_cnt;
       b->bits = malloc (byte_cnt (bit_cnt));
+      b->full = NULL;
+      b->hint = 0;
       if (b->bits != NULL || bit_cnt == 0)
         {
           bitmap_set_all (b, false);
@@ -105,6 +170,8 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->full = NULL;
+  b->hint = 0;
   bitmap_set_all (b, false);
   return b;
 }
@@ -124,10 +191,32 @@ bitmap_destroy (struct bitmap *b)
 {
   if (b != NULL) 
     {
+      free (b->full);
       free (b->bits);
       free (b);
     }
 }
+
+/** Adds a summary level to B, which makes searches for false bits
+   skip over full regions quickly, at the cost of a little extra
+   work on each update.  Returns true if successful, false if
+   memory allocation fails. */
+bool
+bitmap_add_summary (struct bitmap *b) 
+{
+  size_t i;
+
+  ASSERT (b != NULL);
+
+  if (b->full != NULL)
+    return true;
+  b->full = malloc (byte_cnt (elem_cnt (b->bit_cnt)));
+  if (b->full == NULL && elem_cnt (b->bit_cnt) > 0)
+    return false;
+  for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+    update_summary (b, i);
+  return true;
+}
 
 /** Bitmap size. */
 
@@ -163,6 +252,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
   asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  update_summary (b, idx);
 }
 
 /** Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -176,6 +266,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  update_summary (b, idx);
 }
 
 /** Atomically toggles the bit numbered IDX in B;
@@ -191,6 +282,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  update_summary (b, idx);
 }
 
 /** Returns the value of the bit numbered IDX in B. */
@@ -213,18 +305,48 @@ bitmap_set_all (struct bitmap *b, bool value)
   bitmap_set_multiple (b, 0, bitmap_size (b), value);
 }
 
-/** Sets the CNT bits starting at START in B to VALUE. */
+/** Splits the CNT bits starting at *START into pieces that each
+   lie within one element.  Returns false if CNT is 0.  Otherwise,
+   stores the piece's element index into *ELEM and a mask of its
+   bits into *MASK, advances *START and *CNT past it, and returns
+   true. */
+static inline bool
+next_piece (size_t *start, size_t *cnt, size_t *elem, elem_type *mask) 
+{
+  size_t lo = *start % ELEM_BITS;
+  size_t span = ELEM_BITS - lo;
+
+  if (*cnt == 0)
+    return false;
+  if (span > *cnt)
+    span = *cnt;
+  *elem = elem_idx (*start);
+  *mask = range_mask (lo, lo + span);
+  *start += span;
+  *cnt -= span;
+  return true;
+}
+
+/** Sets the CNT bits starting at START in B to VALUE, an element
+   at a time. */
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t elem;
+  elem_type mask;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  while (next_piece (&start, &cnt, &elem, &mask)) 
+    {
+      if (value)
+        b->bits[elem] |= mask;
+      else
+        b->bits[elem] &= ~mask;
+      update_summary (b, elem);
+    }
 }
 
 /** Returns the number of bits in B between START and START + CNT,
@@ -232,16 +354,19 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t elem, value_cnt;
+  elem_type mask;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  while (next_piece (&start, &cnt, &elem, &mask)) 
+    {
+      elem_type bits = value ? b->bits[elem] : ~b->bits[elem];
+      value_cnt += popcount (bits & mask);
+    }
   return value_cnt;
 }
 
@@ -250,15 +375,19 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t elem;
+  elem_type mask;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
+  while (next_piece (&start, &cnt, &elem, &mask)) 
+    {
+      elem_type bits = value ? b->bits[elem] : ~b->bits[elem];
+      if ((bits & mask) != 0)
+        return true;
+    }
   return false;
 }
 
@@ -288,23 +417,121 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /** Finding set or unset bits. */
 
+/** Returns the index of the first element of B at or after ELEM
+   that is not full, according to B's summary, or the number of
+   elements in B if there is none. */
+static size_t
+next_nonfull (const struct bitmap *b, size_t elem) 
+{
+  size_t elem_total = elem_cnt (b->bit_cnt);
+
+  while (elem < elem_total) 
+    {
+      elem_type nonfull = ~b->full[elem_idx (elem)]
+                          & range_mask (elem % ELEM_BITS, ELEM_BITS);
+      if (nonfull != 0)
+        {
+          elem = elem - elem % ELEM_BITS + lowest_bit (nonfull);
+          return elem < elem_total ? elem : elem_total;
+        }
+      elem += ELEM_BITS - elem % ELEM_BITS;
+    }
+  return elem_total;
+}
+
+/** Returns a mask with bit I set for each I such that bits I
+   through I + CNT - 1 of X are all set, for 1 <= CNT <=
+   ELEM_BITS.  Each step doubles the length of the runs that the
+   mask stands for, up to CNT. */
+static elem_type
+runs_of (elem_type x, size_t cnt) 
+{
+  size_t len = 1;
+
+  while (len < cnt && x != 0) 
+    {
+      size_t shift = len < cnt - len ? len : cnt - len;
+      x &= x >> shift;
+      len += shift;
+    }
+  return x;
+}
+
 /** Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Works an element at a time.  A run of VALUE bits that reaches
+   the top of one element carries into the next; a group that
+   lies within one element is found with runs_of().  When
+   searching for false bits in a bitmap with a summary, full
+   elements are skipped without being read. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t run_start = start;     /* Start of the current run. */
+  size_t run = 0;               /* Length of the current run. */
+  size_t idx = start;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt == 0)
+    return start;
+  if (cnt > b->bit_cnt)
+    return BITMAP_ERROR;
+
+  while (idx < b->bit_cnt) 
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t elem = elem_idx (idx);
+      size_t base = elem * ELEM_BITS;
+      size_t lo = idx - base;
+      size_t hi = (b->bit_cnt - base < ELEM_BITS
+                   ? b->bit_cnt - base : ELEM_BITS);
+      elem_type match, gap;
+      size_t ext;
+
+      if (!value && b->full != NULL) 
+        {
+          size_t next = next_nonfull (b, elem);
+          if (next != elem) 
+            {
+              run = 0;
+              idx = next * ELEM_BITS;
+              continue;
+            }
+        }
+
+      /* Bits in [lo, hi) that equal VALUE. */
+      match = (value ? b->bits[elem] : ~b->bits[elem]) & range_mask (lo, hi);
+
+      /* Extend the current run with the matching bits at LO. */
+      if (run == 0)
+        run_start = idx;
+      gap = ~match & range_mask (lo, ELEM_BITS);
+      ext = (gap != 0 ? lowest_bit (gap) : ELEM_BITS) - lo;
+      if (run + ext >= cnt)
+        return run_start;
+      if (lo + ext == hi) 
+        {
+          run += ext;
+          idx = base + hi;
+          continue;
+        }
+
+      /* The run broke within this element.  Look for a whole group
+         inside it, then start a new run from the matching bits at
+         its top. */
+      if (cnt <= ELEM_BITS) 
+        {
+          elem_type groups = runs_of (match, cnt);
+          if (groups != 0)
+            return base + lowest_bit (groups);
+        }
+      run = hi == ELEM_BITS ? leading_ones (match) : 0;
+      run_start = base + ELEM_BITS - run;
+      idx = base + hi;
     }
   return BITMAP_ERROR;
 }
@@ -324,6 +551,31 @@ bitmap_scan_and_flip (struct bitmap *b, size_t start, size_t cnt, bool value)
     bitmap_set_multiple (b, idx, cnt, !value);
   return idx;
 }
+
+/** Like bitmap_scan_and_flip(), but searches next-fit: starting
+   just past the group that the previous call returned and
+   wrapping around to the beginning of B, so that allocating from
+   a mostly full bitmap does not rescan its full prefix each
+   time. */
+size_t
+bitmap_scan_and_flip_next (struct bitmap *b, size_t cnt, bool value) 
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+
+  if (b->hint >= b->bit_cnt)
+    b->hint = 0;
+  idx = bitmap_scan (b, b->hint, cnt, value);
+  if (idx == BITMAP_ERROR && b->hint > 0)
+    idx = bitmap_scan (b, 0, cnt, value);
+  if (idx != BITMAP_ERROR) 
+    {
+      bitmap_set_multiple (b, idx, cnt, !value);
+      b->hint = idx + cnt;
+    }
+  return idx;
+}
 
 /** File input and output. */
 
@@ -344,8 +596,12 @@ bitmap_read (struct bitmap *b, struct file *file)
   if (b->bit_cnt > 0) 
     {
       off_t size = byte_cnt (b->bit_cnt);
+      size_t i;
+
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+        update_summary (b, i);
     }
   return success;
 }
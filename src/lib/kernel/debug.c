@@ -112,12 +112,13 @@ print_stacktrace(struct thread *t, void *aux UNUSED)
   printf (".\n");
 }
 
-/** Prints call stack of all threads. */
+/** Prints call stack of all threads.  The console lock is taken
+   first, because print_stacktrace() may not sleep waiting for
+   it while walking the thread list. */
 void
 debug_backtrace_all (void)
 {
-  enum intr_level oldlevel = intr_disable ();
-
-  thread_foreach (print_stacktrace, 0);
-  intr_set_level (oldlevel);
+  acquire_console ();
+  thread_foreach_rcu (print_stacktrace, 0);
+  release_console ();
 }
@@ -0,0 +1,200 @@
+#include "heap.h"
+#include "../debug.h"
+
+/** Pairing heap.  Each element points to its first child and to
+   its siblings, so that an element can be cut out of the tree in
+   O(1) given only a pointer to it.  See M. L. Fredman, R.
+   Sedgewick, D. D. Sleator, and R. E. Tarjan, "The pairing heap:
+   A new form of self-adjusting heap", Algorithmica 1 (1986). */
+
+static struct heap_elem *link (struct heap *,
+                               struct heap_elem *, struct heap_elem *);
+static struct heap_elem *merge_pairs (struct heap *, struct heap_elem *);
+static void cut (struct heap_elem *);
+
+/** Initializes H as an empty heap that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) 
+{
+  ASSERT (h != NULL);
+  ASSERT (less != NULL);
+
+  h->root = NULL;
+  h->size = 0;
+  h->less = less;
+  h->aux = aux;
+}
+
+/** Returns the number of elements in H. */
+size_t
+heap_size (const struct heap *h) 
+{
+  return h->size;
+}
+
+/** Returns true if H is empty, false otherwise. */
+bool
+heap_empty (const struct heap *h) 
+{
+  return h->root == NULL;
+}
+
+/** Returns the greatest element in H.  H must not be empty. */
+struct heap_elem *
+heap_max (const struct heap *h) 
+{
+  ASSERT (!heap_empty (h));
+  return h->root;
+}
+
+/** Inserts E into H. */
+void
+heap_insert (struct heap *h, struct heap_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  h->root = link (h, h->root, e);
+  h->size++;
+}
+
+/** Removes the greatest element from H and returns it.  H must not
+   be empty. */
+struct heap_elem *
+heap_pop_max (struct heap *h) 
+{
+  struct heap_elem *max = heap_max (h);
+
+  h->root = merge_pairs (h, max->child);
+  h->size--;
+  max->child = NULL;
+  return max;
+}
+
+/** Removes E, which must be in H, from H. */
+void
+heap_remove (struct heap *h, struct heap_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  if (e == h->root)
+    heap_pop_max (h);
+  else
+    {
+      cut (e);
+      h->root = link (h, h->root, merge_pairs (h, e->child));
+      h->size--;
+      e->child = NULL;
+    }
+}
+
+/** Restores H's ordering after the value of element E, which must
+   be in H, has become greater. */
+void
+heap_increase (struct heap *h, struct heap_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  /* E's subtree is still ordered, so just move it to the top. */
+  if (e != h->root)
+    {
+      cut (e);
+      h->root = link (h, h->root, e);
+    }
+}
+
+/** Restores H's ordering after the value of element E, which must
+   be in H, has changed in either direction. */
+void
+heap_update (struct heap *h, struct heap_elem *e) 
+{
+  heap_remove (h, e);
+  heap_insert (h, e);
+}
+
+/** Makes the lesser of roots A and B the first child of the other
+   and returns the new root.  Either may be null. */
+static struct heap_elem *
+link (struct heap *h, struct heap_elem *a, struct heap_elem *b) 
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+
+  if (h->less (a, b, h->aux)) 
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/** Melds the sibling list that starts at FIRST into a single tree
+   and returns its root, or a null pointer if FIRST is null.
+   Uses the standard two passes: link adjacent pairs left to
+   right, then link the results right to left. */
+static struct heap_elem *
+merge_pairs (struct heap *h, struct heap_elem *first) 
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root = NULL;
+
+  /* First pass, collecting the linked pairs in reverse order
+     through their `next' members. */
+  while (first != NULL) 
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->next;
+      struct heap_elem *pair;
+
+      if (b != NULL)
+        {
+          first = b->next;
+          b->next = b->prev = NULL;
+        }
+      else
+        first = NULL;
+      a->next = a->prev = NULL;
+
+      pair = link (h, a, b);
+      pair->next = pairs;
+      pairs = pair;
+    }
+
+  /* Second pass. */
+  while (pairs != NULL) 
+    {
+      struct heap_elem *pair = pairs;
+
+      pairs = pair->next;
+      pair->next = NULL;
+      root = link (h, root, pair);
+    }
+  return root;
+}
+
+/** Detaches non-root element E, with its subtree, from its parent
+   and siblings. */
+static void
+cut (struct heap_elem *e) 
+{
+  ASSERT (e->prev != NULL);
+
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  e->next = e->prev = NULL;
+}
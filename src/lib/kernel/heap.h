@@ -0,0 +1,72 @@
+#ifndef __LIB_KERNEL_HEAP_H
+#define __LIB_KERNEL_HEAP_H
+
+/** Max-heap.
+
+   This is a pairing heap.  Like the doubly linked list in
+   list.h, it does not require dynamically allocated memory:
+   each structure that is a potential heap element must embed a
+   struct heap_elem member, and heap_entry() converts a struct
+   heap_elem back to the structure that contains it.
+
+   The heap orders its elements by a caller-supplied "less than"
+   function and keeps the greatest one at the root.  Finding the
+   maximum and inserting are O(1).  Removing the maximum or an
+   arbitrary element is O(log n) amortized.  heap_increase()
+   restores the heap after an element's key grew, also in O(1),
+   and heap_update() after it changed in either direction.
+
+   Equal elements come out in no particular order.  A heap that
+   must be FIFO among equals should break ties in its less
+   function, for example with a sequence number. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Heap element. */
+struct heap_elem 
+  {
+    struct heap_elem *child;    /**< First child. */
+    struct heap_elem *next;     /**< Next sibling. */
+    struct heap_elem *prev;     /**< Previous sibling, or parent if
+                                     first child, or null if root. */
+  };
+
+/** Converts pointer to heap element HEAP_ELEM into a pointer to
+   the structure that HEAP_ELEM is embedded inside.  Supply the
+   name of the outer structure STRUCT and the member name MEMBER
+   of the heap element. */
+#define heap_entry(HEAP_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(HEAP_ELEM)->next     \
+                     - offsetof (STRUCT, MEMBER.next)))
+
+/** Compares the value of two heap elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool heap_less_func (const struct heap_elem *a,
+                             const struct heap_elem *b,
+                             void *aux);
+
+/** Heap. */
+struct heap 
+  {
+    struct heap_elem *root;     /**< Greatest element, or null. */
+    size_t size;                /**< Number of elements. */
+    heap_less_func *less;       /**< Comparison function. */
+    void *aux;                  /**< Auxiliary data for `less'. */
+  };
+
+void heap_init (struct heap *, heap_less_func *, void *aux);
+
+size_t heap_size (const struct heap *);
+bool heap_empty (const struct heap *);
+struct heap_elem *heap_max (const struct heap *);
+
+void heap_insert (struct heap *, struct heap_elem *);
+struct heap_elem *heap_pop_max (struct heap *);
+void heap_remove (struct heap *, struct heap_elem *);
+void heap_increase (struct heap *, struct heap_elem *);
+void heap_update (struct heap *, struct heap_elem *);
+
+#endif /**< lib/kernel/heap.h */
@@ -0,0 +1,344 @@
+#include "rbtree.h"
+#include "../debug.h"
+
+/** Red-black tree, following the algorithms in T. H. Cormen, C. E.
+   Leiserson, R. L. Rivest, and C. Stein, "Introduction to
+   Algorithms", chapter 13, with null pointers in place of the
+   sentinel leaf.  Because a null leaf has no parent pointer,
+   removal tracks the parent of the node being fixed up
+   separately. */
+
+static void rotate_left (struct rb_tree *, struct rb_elem *);
+static void rotate_right (struct rb_tree *, struct rb_elem *);
+static void replace_child (struct rb_tree *, struct rb_elem *parent,
+                           struct rb_elem *old, struct rb_elem *new);
+static void insert_fixup (struct rb_tree *, struct rb_elem *);
+static void remove_fixup (struct rb_tree *, struct rb_elem *,
+                          struct rb_elem *parent);
+
+static inline bool
+is_red (const struct rb_elem *e) 
+{
+  return e != NULL && e->red;
+}
+
+/** Initializes T as an empty tree that orders its elements with
+   LESS, given auxiliary data AUX. */
+void
+rb_init (struct rb_tree *t, rb_less_func *less, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (less != NULL);
+
+  t->root = t->min = NULL;
+  t->size = 0;
+  t->less = less;
+  t->aux = aux;
+}
+
+/** Returns the number of elements in T. */
+size_t
+rb_size (const struct rb_tree *t) 
+{
+  return t->size;
+}
+
+/** Returns true if T is empty, false otherwise. */
+bool
+rb_empty (const struct rb_tree *t) 
+{
+  return t->root == NULL;
+}
+
+/** Returns the least element in T, or a null pointer if T is
+   empty. */
+struct rb_elem *
+rb_min (const struct rb_tree *t) 
+{
+  return t->min;
+}
+
+/** Returns the element that follows E in its tree, or a null
+   pointer if E is the greatest. */
+struct rb_elem *
+rb_next (const struct rb_elem *e) 
+{
+  ASSERT (e != NULL);
+
+  if (e->right != NULL) 
+    {
+      e = e->right;
+      while (e->left != NULL)
+        e = e->left;
+      return (struct rb_elem *) e;
+    }
+  while (e->parent != NULL && e == e->parent->right)
+    e = e->parent;
+  return e->parent;
+}
+
+/** Inserts E into T, after any elements equal to it. */
+void
+rb_insert (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem **link = &t->root;
+  struct rb_elem *parent = NULL;
+  bool leftmost = true;
+
+  ASSERT (e != NULL);
+
+  while (*link != NULL) 
+    {
+      parent = *link;
+      if (t->less (e, parent, t->aux))
+        link = &parent->left;
+      else 
+        {
+          link = &parent->right;
+          leftmost = false;
+        }
+    }
+
+  e->parent = parent;
+  e->left = e->right = NULL;
+  e->red = true;
+  *link = e;
+  if (leftmost)
+    t->min = e;
+  t->size++;
+
+  insert_fixup (t, e);
+}
+
+/** Removes E, which must be in T, from T. */
+void
+rb_remove (struct rb_tree *t, struct rb_elem *e) 
+{
+  struct rb_elem *y, *x, *x_parent;
+  bool y_red;
+
+  ASSERT (e != NULL);
+  ASSERT (t->size > 0);
+
+  if (t->min == e)
+    t->min = rb_next (e);
+
+  /* Y is the element actually unlinked from its place: E itself if
+     it has at most one child, otherwise E's successor, which has
+     no left child and moves into E's place. */
+  if (e->left == NULL || e->right == NULL)
+    y = e;
+  else 
+    {
+      y = e->right;
+      while (y->left != NULL)
+        y = y->left;
+    }
+
+  x = y->left != NULL ? y->left : y->right;
+  x_parent = y->parent;
+  if (x != NULL)
+    x->parent = y->parent;
+  replace_child (t, y->parent, y, x);
+  y_red = y->red;
+
+  if (y != e) 
+    {
+      if (x_parent == e)
+        x_parent = y;
+      y->left = e->left;
+      y->right = e->right;
+      y->parent = e->parent;
+      y->red = e->red;
+      if (y->left != NULL)
+        y->left->parent = y;
+      if (y->right != NULL)
+        y->right->parent = y;
+      replace_child (t, e->parent, e, y);
+    }
+  t->size--;
+
+  if (!y_red)
+    remove_fixup (t, x, x_parent);
+}
+
+/** Makes NEW take OLD's place as a child of PARENT, or as T's root
+   if PARENT is null. */
+static void
+replace_child (struct rb_tree *t, struct rb_elem *parent,
+               struct rb_elem *old, struct rb_elem *new) 
+{
+  if (parent == NULL)
+    t->root = new;
+  else if (parent->left == old)
+    parent->left = new;
+  else
+    parent->right = new;
+}
+
+/** Rotates X's right child up into X's place. */
+static void
+rotate_left (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->right;
+
+  x->right = y->left;
+  if (y->left != NULL)
+    y->left->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+}
+
+/** Rotates X's left child up into X's place. */
+static void
+rotate_right (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *y = x->left;
+
+  x->left = y->right;
+  if (y->right != NULL)
+    y->right->parent = x;
+  y->parent = x->parent;
+  replace_child (t, x->parent, x, y);
+  y->right = x;
+  x->parent = y;
+}
+
+/** Restores the red-black properties after red element X was
+   inserted. */
+static void
+insert_fixup (struct rb_tree *t, struct rb_elem *x) 
+{
+  struct rb_elem *p;
+
+  while ((p = x->parent) != NULL && p->red) 
+    {
+      /* P is red, so it is not the root and has a parent. */
+      struct rb_elem *g = p->parent;
+
+      if (p == g->left) 
+        {
+          struct rb_elem *u = g->right;
+
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              x = g;
+              continue;
+            }
+          if (x == p->right) 
+            {
+              rotate_left (t, p);
+              x = p;
+              p = x->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_right (t, g);
+        }
+      else 
+        {
+          struct rb_elem *u = g->left;
+
+          if (is_red (u)) 
+            {
+              p->red = u->red = false;
+              g->red = true;
+              x = g;
+              continue;
+            }
+          if (x == p->left) 
+            {
+              rotate_right (t, p);
+              x = p;
+              p = x->parent;
+            }
+          p->red = false;
+          g->red = true;
+          rotate_left (t, g);
+        }
+    }
+  t->root->red = false;
+}
+
+/** Restores the red-black properties after a black element was
+   unlinked, leaving X, which may be null, one black short.
+   PARENT is X's parent. */
+static void
+remove_fixup (struct rb_tree *t, struct rb_elem *x, struct rb_elem *parent) 
+{
+  while (x != t->root && !is_red (x)) 
+    {
+      if (x == parent->left) 
+        {
+          struct rb_elem *w = parent->right;
+
+          if (w->red) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_left (t, parent);
+              w = parent->right;
+            }
+          if (!is_red (w->left) && !is_red (w->right)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->right)) 
+                {
+                  w->left->red = false;
+                  w->red = true;
+                  rotate_right (t, w);
+                  w = parent->right;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->right->red = false;
+              rotate_left (t, parent);
+              x = t->root;
+            }
+        }
+      else 
+        {
+          struct rb_elem *w = parent->left;
+
+          if (w->red) 
+            {
+              w->red = false;
+              parent->red = true;
+              rotate_right (t, parent);
+              w = parent->left;
+            }
+          if (!is_red (w->left) && !is_red (w->right)) 
+            {
+              w->red = true;
+              x = parent;
+              parent = x->parent;
+            }
+          else 
+            {
+              if (!is_red (w->left)) 
+                {
+                  w->right->red = false;
+                  w->red = true;
+                  rotate_left (t, w);
+                  w = parent->left;
+                }
+              w->red = parent->red;
+              parent->red = false;
+              w->left->red = false;
+              rotate_right (t, parent);
+              x = t->root;
+            }
+        }
+    }
+  if (x != NULL)
+    x->red = false;
+}
@@ -0,0 +1,69 @@
+#ifndef __LIB_KERNEL_RBTREE_H
+#define __LIB_KERNEL_RBTREE_H
+
+/** Red-black tree.
+
+   A balanced binary search tree: insertion and removal are
+   O(log n) in the worst case.  The tree also keeps a pointer to
+   its least element, so rb_min() is O(1), which suits a
+   scheduler's "run the thread with the smallest key" pattern.
+
+   Like the doubly linked list in list.h, the tree does not
+   require dynamically allocated memory: each structure that is a
+   potential tree element must embed a struct rb_elem member, and
+   rb_entry() converts a struct rb_elem back to the structure
+   that contains it.
+
+   Equal elements are allowed.  An element inserted after equal
+   elements is placed after them, so among equals rb_min() and
+   rb_next() see elements in insertion order. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Tree element. */
+struct rb_elem 
+  {
+    struct rb_elem *parent;     /**< Parent, or null if root. */
+    struct rb_elem *left;       /**< Left child, or null. */
+    struct rb_elem *right;      /**< Right child, or null. */
+    bool red;                   /**< Red or black? */
+  };
+
+/** Converts pointer to tree element RB_ELEM into a pointer to the
+   structure that RB_ELEM is embedded inside.  Supply the name of
+   the outer structure STRUCT and the member name MEMBER of the
+   tree element. */
+#define rb_entry(RB_ELEM, STRUCT, MEMBER)               \
+        ((STRUCT *) ((uint8_t *) &(RB_ELEM)->parent     \
+                     - offsetof (STRUCT, MEMBER.parent)))
+
+/** Compares the value of two tree elements A and B, given
+   auxiliary data AUX.  Returns true if A is less than B, or
+   false if A is greater than or equal to B. */
+typedef bool rb_less_func (const struct rb_elem *a,
+                           const struct rb_elem *b,
+                           void *aux);
+
+/** Red-black tree. */
+struct rb_tree 
+  {
+    struct rb_elem *root;       /**< Root, or null if empty. */
+    struct rb_elem *min;        /**< Least element, or null if empty. */
+    size_t size;                /**< Number of elements. */
+    rb_less_func *less;         /**< Comparison function. */
+    void *aux;                  /**< Auxiliary data for `less'. */
+  };
+
+void rb_init (struct rb_tree *, rb_less_func *, void *aux);
+
+size_t rb_size (const struct rb_tree *);
+bool rb_empty (const struct rb_tree *);
+struct rb_elem *rb_min (const struct rb_tree *);
+struct rb_elem *rb_next (const struct rb_elem *);
+
+void rb_insert (struct rb_tree *, struct rb_elem *);
+void rb_remove (struct rb_tree *, struct rb_elem *);
+
+#endif /**< lib/kernel/rbtree.h */
@@ -0,0 +1,65 @@
+/** Checks that timer_hrsleep() blocks threads for sub-tick
+   intervals and wakes them in order of their deadlines, never
+   early. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 5
+#define SPACING_NS (1000 * 1000)        /**< 1 ms between deadlines. */
+
+static thread_func hrsleeper;
+static struct semaphore start_sema;
+static struct semaphore done_sema;
+static int64_t base_ns;
+
+void
+test_alarm_hrsleep (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&start_sema, 0);
+  sema_init (&done_sema, 0);
+
+  /* Each thread runs as soon as it is created and waits for the
+     common start. */
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      static int ids[THREAD_CNT];
+      char name[16];
+
+      ids[i] = i;
+      snprintf (name, sizeof name, "hrsleeper %d", i);
+      thread_create (name, PRI_DEFAULT + 1, hrsleeper, &ids[i]);
+    }
+
+  /* Thread I is due I ms after the last one, so they should wake
+     up in reverse order of creation. */
+  base_ns = timer_ns () + SPACING_NS;
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_up (&start_sema);
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done_sema);
+}
+
+static void
+hrsleeper (void *id_) 
+{
+  int id = *(int *) id_;
+  int64_t deadline;
+
+  sema_down (&start_sema);
+  deadline = base_ns + (THREAD_CNT - 1 - id) * SPACING_NS;
+  timer_hrsleep (deadline - timer_ns ());
+  if (timer_ns () < deadline)
+    fail ("thread %d woke up %lld ns early", id, deadline - timer_ns ());
+  msg ("Thread %d woke up.", id);
+  sema_up (&done_sema);
+}
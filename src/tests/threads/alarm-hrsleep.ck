@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-hrsleep) begin
+(alarm-hrsleep) Thread 4 woke up.
+(alarm-hrsleep) Thread 3 woke up.
+(alarm-hrsleep) Thread 2 woke up.
+(alarm-hrsleep) Thread 1 woke up.
+(alarm-hrsleep) Thread 0 woke up.
+(alarm-hrsleep) end
+EOF
+pass;
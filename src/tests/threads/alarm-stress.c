@@ -0,0 +1,118 @@
+/** Puts thousands of threads to sleep at once, each until a
+   different tick, and reports how long the timer interrupt
+   handler takes per tick while nothing is due and while the
+   sleepers expire.  Also verifies that no thread wakes up before
+   its deadline.
+
+   Needs more than the default 4 MB of RAM for the threads'
+   pages; Make.tests passes -m 32 to pintos. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 2000        /**< Number of sleeping threads. */
+#define SPREAD 500              /**< Deadlines span this many ticks. */
+
+/** One sleeping thread. */
+struct sleeper
+  {
+    int64_t deadline;           /**< Tick to wake up on. */
+    int64_t woke;               /**< Tick actually woken up on. */
+  };
+
+static thread_func sleeper_thread;
+static struct semaphore done_sema;
+static void report (const char *phase);
+
+void
+test_alarm_stress (void) 
+{
+  struct sleeper *sleepers;
+  int64_t start;
+  int early = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep once each, for up to %d ticks.",
+       SLEEPER_CNT, SPREAD);
+
+  sleepers = malloc (sizeof *sleepers * SLEEPER_CNT);
+  if (sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+  sema_init (&done_sema, 0);
+
+  /* Baseline: only the main thread is asleep. */
+  timer_sleep (1);
+  timer_irq_stats_reset ();
+  timer_sleep (50);
+  report ("No sleepers");
+
+  /* Spread the deadlines over SPREAD ticks, starting well after
+     all the threads should have been created. */
+  start = timer_ticks () + 200;
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      char name[16];
+
+      sleepers[i].deadline = start + 1 + (i * 37) % SPREAD;
+      sleepers[i].woke = 0;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT + 1, sleeper_thread,
+                         &sleepers[i]) == TID_ERROR)
+        fail ("thread_create() failed for sleeper %d", i);
+    }
+
+  /* Every sleeper is now blocked, but none is due yet. */
+  timer_irq_stats_reset ();
+  timer_sleep (start - timer_ticks ());
+  report ("Nothing due");
+
+  timer_irq_stats_reset ();
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&done_sema);
+  report ("Expiring");
+
+  for (i = 0; i < SLEEPER_CNT; i++)
+    if (sleepers[i].woke < sleepers[i].deadline)
+      early++;
+  if (early != 0)
+    fail ("%d threads woke up before their deadlines", early);
+  msg ("All %d threads woke up no earlier than their deadlines.",
+       SLEEPER_CNT);
+
+  free (sleepers);
+}
+
+/** Sleeper thread. */
+static void
+sleeper_thread (void *sleeper_) 
+{
+  struct sleeper *s = sleeper_;
+
+  timer_sleep (s->deadline - timer_ticks ());
+  s->woke = timer_ticks ();
+  sema_up (&done_sema);
+}
+
+/** Prints the timer interrupt statistics gathered during PHASE. */
+static void
+report (const char *phase) 
+{
+  struct timer_irq_stats stats;
+
+  timer_irq_stats (&stats);
+  if (stats.ticks == 0)
+    return;
+  msg ("%s: %"PRId64" ticks, %"PRId64" wakeups, %"PRIu64" cycles per tick "
+       "on average, %"PRIu64" at most.",
+       phase, stats.ticks, stats.wakeups,
+       stats.total_cycles / stats.ticks, stats.max_cycles);
+}
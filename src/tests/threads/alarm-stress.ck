@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings differ from run to run, so only check that each phase
+# was reported.
+foreach my $phase ('No sleepers', 'Nothing due', 'Expiring') {
+    fail "No timing reported for \"$phase\" phase.\n"
+      if !grep (/^\(alarm-stress\) $phase: \d+ ticks, \d+ wakeups, \d+ cycles per tick/, @output);
+}
+@output = grep (!/cycles per tick/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-stress) begin
+(alarm-stress) Creating 2000 threads to sleep once each, for up to 500 ticks.
+(alarm-stress) All 2000 threads woke up no earlier than their deadlines.
+(alarm-stress) end
+EOF
+pass;
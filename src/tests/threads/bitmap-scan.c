@@ -0,0 +1,102 @@
+/** Checks the word-at-a-time bitmap search against a bit-by-bit
+   reference on random bitmaps of various sizes and densities,
+   with and without a summary level, and checks that next-fit
+   allocation wraps around and hands out every free bit once.
+   Then times a scan for the free bits at the end of a large,
+   almost full bitmap with a summary. */
+
+#include <bitmap.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "devices/tsc.h"
+
+#define TRIAL_CNT 200
+#define QUERY_CNT 50
+#define BIG_BITS (1024 * 1024)
+
+/** Reference implementation of bitmap_scan(). */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++) 
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+void
+test_bitmap_scan (void) 
+{
+  struct bitmap *b;
+  size_t mismatches = 0;
+  size_t taken, idx;
+  uint64_t start;
+  int trial, q;
+
+  random_init (0);
+  for (trial = 0; trial < TRIAL_CNT; trial++) 
+    {
+      size_t bit_cnt = random_ulong () % 500 + 1;
+      unsigned density = random_ulong () % 100;
+      size_t i;
+
+      b = bitmap_create (bit_cnt);
+      if (b == NULL || (trial % 2 && !bitmap_add_summary (b)))
+        fail ("out of memory");
+      for (i = 0; i < bit_cnt; i++)
+        bitmap_set (b, i, random_ulong () % 100 < density);
+
+      for (q = 0; q < QUERY_CNT; q++) 
+        {
+          size_t first = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % (q % 2 ? 8 : 80) + 1;
+          bool value = random_ulong () % 2;
+
+          if (bitmap_scan (b, first, cnt, value)
+              != slow_scan (b, first, cnt, value))
+            mismatches++;
+        }
+      bitmap_destroy (b);
+    }
+  msg ("%d random bitmaps searched, %zu mismatches.", TRIAL_CNT, mismatches);
+
+  /* Next-fit: after taking the middle bit, single-bit allocations
+     continue from there, wrap, and cover the rest exactly once. */
+  b = bitmap_create (100);
+  if (b == NULL || !bitmap_add_summary (b))
+    fail ("out of memory");
+  bitmap_mark (b, 50);
+  if (bitmap_scan_and_flip_next (b, 1, false) != 0)
+    fail ("first next-fit allocation was not bit 0");
+  bitmap_reset (b, 0);
+  bitmap_scan_and_flip_next (b, 50, false);
+  for (taken = 0; bitmap_scan_and_flip_next (b, 1, false) != BITMAP_ERROR;
+       taken++)
+    continue;
+  msg ("Next-fit took %zu more bits, %zu left free.",
+       taken, bitmap_count (b, 0, 100, false));
+  bitmap_destroy (b);
+
+  /* A large bitmap, full except for its last few bits. */
+  b = bitmap_create (BIG_BITS);
+  if (b == NULL || !bitmap_add_summary (b))
+    fail ("out of memory");
+  bitmap_set_multiple (b, 0, BIG_BITS - 16, true);
+  start = tsc_read ();
+  idx = bitmap_scan (b, 0, 16, false);
+  msg ("Found the free tail of a %d-bit bitmap in %"PRIu64" cycles.",
+       BIG_BITS, tsc_read () - start);
+  msg ("Free tail at the right place: %s.",
+       idx == BIG_BITS - 16 ? "yes" : "no");
+  bitmap_destroy (b);
+}
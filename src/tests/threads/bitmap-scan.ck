@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings differ from run to run, so only check that they were
+# reported.
+fail "No timing reported.\n" if !grep (/in \d+ cycles\./, @output);
+@output = grep (!/in \d+ cycles\./, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(bitmap-scan) begin
+(bitmap-scan) 200 random bitmaps searched, 0 mismatches.
+(bitmap-scan) Next-fit took 49 more bits, 0 left free.
+(bitmap-scan) Free tail at the right place: yes.
+(bitmap-scan) end
+EOF
+pass;
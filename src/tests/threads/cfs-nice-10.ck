@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::fair;
+
+check_share_fair ([1024, 820, 655, 526, 423, 335, 272, 215, 172, 137], 25);
@@ -0,0 +1,57 @@
+/** Checks admission control for EDF threads.  The total density,
+   RUNTIME / DEADLINE summed over all EDF threads, must stay within
+   EDF_UTIL_MAX percent.  A thread may change its own parameters,
+   and leaving the EDF class or exiting gives its share back. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func rt_thread;
+static struct semaphore ready, done;
+
+static void
+try (int64_t runtime, int64_t period, int64_t deadline) 
+{
+  msg ("%s asks for runtime %lld, period %lld, deadline %lld: %s.",
+       thread_name (), runtime, period, deadline,
+       thread_set_deadline (runtime, period, deadline)
+       ? "admitted" : "rejected");
+}
+
+void
+test_edf_admit (void) 
+{
+  ASSERT (EDF_UTIL_MAX >= 90 && EDF_UTIL_MAX < 100);
+
+  sema_init (&ready, 0);
+  sema_init (&done, 0);
+
+  try (3, 10, 10);
+  thread_create ("rt", PRI_DEFAULT, rt_thread, NULL);
+  sema_down (&ready);
+
+  /* "rt" holds 50%. */
+  try (5, 10, 10);
+  try (4, 10, 10);
+  try (2, 10, 4);
+  try (2, 20, 5);
+
+  /* Give everything back. */
+  thread_clear_deadline ();
+  sema_up (&done);
+  msg ("rt should have exited.");
+  try (9, 10, 10);
+  thread_clear_deadline ();
+}
+
+static void
+rt_thread (void *aux UNUSED) 
+{
+  try (5, 10, 10);
+  sema_up (&ready);
+  sema_down (&done);
+  msg ("rt exiting.");
+}
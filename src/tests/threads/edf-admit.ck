@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) main asks for runtime 3, period 10, deadline 10: admitted.
+(edf-admit) rt asks for runtime 5, period 10, deadline 10: admitted.
+(edf-admit) main asks for runtime 5, period 10, deadline 10: rejected.
+(edf-admit) main asks for runtime 4, period 10, deadline 10: admitted.
+(edf-admit) main asks for runtime 2, period 10, deadline 4: rejected.
+(edf-admit) main asks for runtime 2, period 20, deadline 5: admitted.
+(edf-admit) rt exiting.
+(edf-admit) rt should have exited.
+(edf-admit) main asks for runtime 9, period 10, deadline 10: admitted.
+(edf-admit) end
+EOF
+pass;
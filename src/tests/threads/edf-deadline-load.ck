@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline-load) begin
+(edf-deadline-load) Starting 3 EDF threads...
+(edf-deadline-load) CPU-bound threads ran: yes.
+(edf-deadline-load) edf 0 missed 0 deadlines.
+(edf-deadline-load) edf 1 missed 0 deadlines.
+(edf-deadline-load) edf 2 missed 0 deadlines.
+(edf-deadline-load) end
+EOF
+pass;
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-deadline-overrun) begin
+(edf-deadline-overrun) Starting 2 EDF threads...
+(edf-deadline-overrun) CPU-bound threads ran: yes.
+(edf-deadline-overrun) edf 0 missed 0 deadlines.
+(edf-deadline-overrun) edf 1 missed every deadline: yes.
+(edf-deadline-overrun) end
+EOF
+pass;
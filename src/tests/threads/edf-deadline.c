@@ -0,0 +1,161 @@
+/** Checks that EDF threads meet their deadlines under load.
+
+   The edf-deadline-load test runs 3 EDF threads with different
+   periods, together claiming about 82% of the CPU, against 3
+   CPU-bound threads at the default priority.  Each EDF job spins
+   for fewer ticks than its budget, so no job should miss its
+   deadline, and the CPU-bound threads should still get the rest
+   of the CPU.
+
+   The edf-deadline-overrun test runs one EDF thread whose every
+   job needs more than its budget next to a well-behaved one.  The
+   overrunning thread must be throttled, missing the deadline of
+   every job, without making the other miss any or starving the
+   CPU-bound threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define JOB_CNT 20
+#define HOG_CNT 3
+
+struct edf_info 
+  {
+    int64_t runtime;            /* Budget per job, in ticks. */
+    int64_t period;             /* Also the deadline. */
+    int work;                   /* Ticks each job spins. */
+    int misses;                 /* Deadline misses seen. */
+    struct semaphore done;
+  };
+
+static void test_edf_deadline (struct edf_info *, int edf_cnt);
+static thread_func edf_thread;
+static thread_func hog_thread;
+
+static volatile bool hogs_stop;
+static int hog_ticks[HOG_CNT];
+static struct semaphore hogs_done;
+
+void
+test_edf_deadline_load (void) 
+{
+  struct edf_info info[] = 
+    {
+      {.runtime = 3, .period = 10, .work = 1},
+      {.runtime = 4, .period = 15, .work = 2},
+      {.runtime = 5, .period = 20, .work = 3},
+    };
+  int i;
+
+  test_edf_deadline (info, 3);
+  for (i = 0; i < 3; i++)
+    msg ("edf %d missed %d deadlines.", i, info[i].misses);
+}
+
+void
+test_edf_deadline_overrun (void) 
+{
+  struct edf_info info[] = 
+    {
+      {.runtime = 4, .period = 10, .work = 2},
+      {.runtime = 2, .period = 10, .work = 5},
+    };
+
+  test_edf_deadline (info, 2);
+  msg ("edf 0 missed %d deadlines.", info[0].misses);
+  msg ("edf 1 missed every deadline: %s.",
+       info[1].misses >= JOB_CNT ? "yes" : "no");
+}
+
+/** Runs EDF_CNT EDF threads described by INFO, each for JOB_CNT
+   jobs, against HOG_CNT CPU-bound threads. */
+static void
+test_edf_deadline (struct edf_info *info, int edf_cnt) 
+{
+  int total;
+  int i;
+
+  hogs_stop = false;
+  sema_init (&hogs_done, 0);
+  for (i = 0; i < HOG_CNT; i++) 
+    {
+      hog_ticks[i] = 0;
+      thread_create ("hog", PRI_DEFAULT, hog_thread, &hog_ticks[i]);
+    }
+
+  msg ("Starting %d EDF threads...", edf_cnt);
+  for (i = 0; i < edf_cnt; i++) 
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "edf %d", i);
+      sema_init (&info[i].done, 0);
+      thread_create (name, PRI_DEFAULT, edf_thread, &info[i]);
+    }
+  for (i = 0; i < edf_cnt; i++)
+    sema_down (&info[i].done);
+
+  hogs_stop = true;
+  total = 0;
+  for (i = 0; i < HOG_CNT; i++) 
+    {
+      sema_down (&hogs_done);
+      total += hog_ticks[i];
+    }
+  msg ("CPU-bound threads ran: %s.", total > 0 ? "yes" : "no");
+}
+
+/** Spins until the timer has ticked TICKS times. */
+static void
+spin (int ticks) 
+{
+  int64_t last = timer_ticks ();
+
+  while (ticks > 0) 
+    {
+      int64_t now = timer_ticks ();
+      if (now != last) 
+        {
+          ticks--;
+          last = now;
+        }
+    }
+}
+
+static void
+edf_thread (void *info_) 
+{
+  struct edf_info *info = info_;
+  int i;
+
+  if (!thread_set_deadline (info->runtime, info->period, info->period))
+    fail ("%s not admitted", thread_name ());
+  for (i = 0; i < JOB_CNT; i++) 
+    {
+      spin (info->work);
+      thread_deadline_yield ();
+    }
+  info->misses = thread_deadline_misses ();
+  thread_clear_deadline ();
+  sema_up (&info->done);
+}
+
+static void
+hog_thread (void *ticks_) 
+{
+  int *ticks = ticks_;
+  int64_t last = timer_ticks ();
+
+  while (!hogs_stop) 
+    {
+      int64_t now = timer_ticks ();
+      if (now != last)
+        ++*ticks;
+      last = now;
+    }
+  sema_up (&hogs_done);
+}
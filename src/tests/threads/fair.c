@@ -0,0 +1,188 @@
+/** Measures the fairness of the stride and virtual-runtime fair
+   schedulers.  Each test gives its threads a share of the CPU,
+   tickets for the stride scheduler or a nice value for the fair
+   scheduler, lets them spin for 30 seconds, and reports how many
+   ticks each one received.  The ticks should sum to approximately
+   30 * 100 == 3000.
+
+   The stride-fair and cfs-fair tests run either 2 or 20 threads
+   with equal shares, so the threads should all receive
+   approximately the same number of ticks.
+
+   The stride-tickets-2 test runs 2 threads with 100 and 300
+   tickets, which should receive 750 and 2,250 ticks,
+   respectively.
+
+   The stride-tickets-10 test runs 10 threads with 10, 20, ...,
+   100 tickets.  Thread i should receive 3000 * (i + 1) / 55
+   ticks, from 55 up to 545.
+
+   The cfs-nice-2 test runs 2 threads at nice 0 and 5, whose
+   weights are 1024 and 335, so they should receive about 2,260
+   and 740 ticks, respectively.
+
+   The cfs-nice-10 test runs 10 threads at nice 0 through 9.
+   Each nice level is worth about 1.25 times the next, so thread
+   0 should receive about 670 ticks and thread 9 about 90. */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/** Sets the running thread's share of the CPU. */
+typedef void set_share_func (int share);
+
+static void test_stride_fair (int thread_cnt, int tickets_min,
+                              int tickets_step);
+static void test_cfs_fair (int thread_cnt, int nice_min, int nice_step);
+static void test_fair (int thread_cnt, int share_min, int share_step,
+                       set_share_func *, int main_share);
+
+void
+test_stride_fair_2 (void) 
+{
+  test_stride_fair (2, 100, 0);
+}
+
+void
+test_stride_fair_20 (void) 
+{
+  test_stride_fair (20, 100, 0);
+}
+
+void
+test_stride_tickets_2 (void) 
+{
+  test_stride_fair (2, 100, 200);
+}
+
+void
+test_stride_tickets_10 (void) 
+{
+  test_stride_fair (10, 10, 10);
+}
+
+void
+test_cfs_fair_2 (void) 
+{
+  test_cfs_fair (2, 0, 0);
+}
+
+void
+test_cfs_fair_20 (void) 
+{
+  test_cfs_fair (20, 0, 0);
+}
+
+void
+test_cfs_nice_2 (void) 
+{
+  test_cfs_fair (2, 0, 5);
+}
+
+void
+test_cfs_nice_10 (void) 
+{
+  test_cfs_fair (10, 0, 1);
+}
+
+static void
+test_stride_fair (int thread_cnt, int tickets_min, int tickets_step)
+{
+  ASSERT (thread_stride);
+  ASSERT (tickets_min >= TICKETS_MIN);
+  ASSERT (tickets_step >= 0);
+  ASSERT (tickets_min + tickets_step * (thread_cnt - 1) <= TICKETS_MAX);
+
+  test_fair (thread_cnt, tickets_min, tickets_step,
+             thread_set_tickets, TICKETS_MAX);
+}
+
+static void
+test_cfs_fair (int thread_cnt, int nice_min, int nice_step)
+{
+  ASSERT (thread_cfs);
+  ASSERT (nice_min >= NICE_MIN);
+  ASSERT (nice_step >= 0);
+  ASSERT (nice_min + nice_step * (thread_cnt - 1) <= NICE_MAX);
+
+  test_fair (thread_cnt, nice_min, nice_step, thread_set_nice, NICE_MIN);
+}
+
+#define MAX_THREAD_CNT 20
+
+struct thread_info 
+  {
+    int64_t start_time;
+    int tick_count;
+    int share;
+    set_share_func *set_share;
+  };
+
+static void load_thread (void *aux);
+
+/** Runs THREAD_CNT threads whose shares, set with SET_SHARE, start
+   at SHARE_MIN and go up by SHARE_STEP.  The main thread takes
+   MAIN_SHARE meanwhile, so that it gets to start all of them. */
+static void
+test_fair (int thread_cnt, int share_min, int share_step,
+           set_share_func *set_share, int main_share)
+{
+  struct thread_info info[MAX_THREAD_CNT];
+  int64_t start_time;
+  int share;
+  int i;
+
+  ASSERT (thread_cnt <= MAX_THREAD_CNT);
+
+  set_share (main_share);
+
+  start_time = timer_ticks ();
+  msg ("Starting %d threads...", thread_cnt);
+  share = share_min;
+  for (i = 0; i < thread_cnt; i++) 
+    {
+      struct thread_info *ti = &info[i];
+      char name[16];
+
+      ti->start_time = start_time;
+      ti->tick_count = 0;
+      ti->share = share;
+      ti->set_share = set_share;
+
+      snprintf(name, sizeof name, "load %d", i);
+      thread_create (name, PRI_DEFAULT, load_thread, ti);
+
+      share += share_step;
+    }
+  msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
+
+  msg ("Sleeping 40 seconds to let threads run, please wait...");
+  timer_sleep (40 * TIMER_FREQ);
+  
+  for (i = 0; i < thread_cnt; i++)
+    msg ("Thread %d received %d ticks.", i, info[i].tick_count);
+}
+
+static void
+load_thread (void *ti_) 
+{
+  struct thread_info *ti = ti_;
+  int64_t sleep_time = 5 * TIMER_FREQ;
+  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t last_time = 0;
+
+  ti->set_share (ti->share);
+  timer_sleep (sleep_time - timer_elapsed (ti->start_time));
+  while (timer_elapsed (ti->start_time) < spin_time) 
+    {
+      int64_t cur_time = timer_ticks ();
+      if (cur_time != last_time)
+        ti->tick_count++;
+      last_time = cur_time;
+    }
+}
@@ -0,0 +1,41 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::threads::mlfqs;
+
+# Returns the ticks that threads with the given shares of the CPU
+# should each receive out of the 3000 that the fair tests spin
+# for.
+sub share_expected_ticks {
+    my (@shares) = @_;
+    my ($total) = 0;
+    $total += $_ foreach @shares;
+    return map (3000 * $_ / $total, @shares);
+}
+
+# Checks that each thread received ticks in proportion to its
+# share: its tickets under the stride scheduler, or the weight of
+# its nice value under the fair scheduler.
+sub check_share_fair {
+    my ($shares, $maxdiff) = @_;
+    our ($test);
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    my (@actual);
+    local ($_);
+    foreach (@output) {
+	my ($id, $count) = /Thread (\d+) received (\d+) ticks\./ or next;
+        $actual[$id] = $count;
+    }
+
+    my (@expected) = share_expected_ticks (@$shares);
+    mlfqs_compare ("thread", "%d",
+		   \@actual, \@expected, $maxdiff, [0, $#$shares, 1],
+		   "Some tick counts were missing or differed from those "
+		   . "expected by more than $maxdiff.");
+    pass;
+}
+
+1;
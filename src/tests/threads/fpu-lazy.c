@@ -0,0 +1,63 @@
+/** Checks that x87 FPU state survives context switches.  Several
+   threads each load a distinct value onto the FPU stack and then
+   yield to one another repeatedly before popping it back off.
+   With lazy switching, each thread's first FPU instruction after
+   another thread used the FPU traps and swaps the state in, while
+   the main thread, which never touches the FPU, gets no save
+   area at all. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+#define YIELD_CNT 10
+
+static thread_func fpu_thread;
+static struct semaphore done;
+static int results[THREAD_CNT];
+
+void
+test_fpu_lazy (void) 
+{
+  int i;
+
+  sema_init (&done, 0);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "fpu %d", i);
+      thread_create (name, PRI_DEFAULT, fpu_thread, (void *) i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (results[i] == i * 1000 + 7)
+      msg ("thread %d kept its FPU state", i);
+    else
+      msg ("thread %d got %d instead of %d", i, results[i], i * 1000 + 7);
+
+  if (thread_current ()->fpu != NULL)
+    fail ("main thread has an FPU save area");
+  msg ("main thread has no FPU save area");
+}
+
+static void
+fpu_thread (void *aux) 
+{
+  int id = (int) aux;
+  int value = id * 1000 + 7;
+  int result;
+  int i;
+
+  asm volatile ("fildl %0" : : "m" (value));
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  asm volatile ("fistpl %0" : "=m" (result));
+
+  results[id] = result;
+  sema_up (&done);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fpu-lazy) begin
+(fpu-lazy) thread 0 kept its FPU state
+(fpu-lazy) thread 1 kept its FPU state
+(fpu-lazy) thread 2 kept its FPU state
+(fpu-lazy) thread 3 kept its FPU state
+(fpu-lazy) main thread has no FPU save area
+(fpu-lazy) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/** Checks the statistics lockstat gathers for a named lock.  The
+   main thread holds the lock while two higher-priority threads
+   block on it, each donating its priority, and then lets them
+   take it in turn.  A final lock_try_acquire() counts as an
+   uncontended acquisition.  The lock stays tracked, so it also
+   shows up in the statistics printed at shutdown. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func waiter_thread;
+static struct lock lock;
+
+void
+test_lockstat (void) 
+{
+  const struct lockstat *s = &lock.semaphore.stat;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+  ASSERT (lockstat_enabled);
+
+  lock_init (&lock);
+  lock_set_name (&lock, "lockstat test");
+
+  lock_acquire (&lock);
+  thread_create ("waiter 1", PRI_DEFAULT + 1, waiter_thread, NULL);
+  thread_create ("waiter 2", PRI_DEFAULT + 2, waiter_thread, NULL);
+  msg ("Releasing the lock.");
+  lock_release (&lock);
+
+  if (!lock_try_acquire (&lock))
+    fail ("lock_try_acquire() failed");
+  lock_release (&lock);
+
+  msg ("Acquired %u times, %u contended.", s->acquired, s->contended);
+  msg ("%u donations.", s->donations);
+  msg ("Longest wait within total: %s.",
+       s->wait_max <= s->wait_total ? "yes" : "no");
+  msg ("Longest hold within total: %s.",
+       s->hold_max <= s->hold_total ? "yes" : "no");
+}
+
+static void
+waiter_thread (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("%s got the lock.", thread_name ());
+  lock_release (&lock);
+}
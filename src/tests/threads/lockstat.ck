@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lockstat) begin
+(lockstat) Releasing the lock.
+(lockstat) waiter 2 got the lock.
+(lockstat) waiter 1 got the lock.
+(lockstat) Acquired 4 times, 2 contended.
+(lockstat) 2 donations.
+(lockstat) Longest wait within total: yes.
+(lockstat) Longest hold within total: yes.
+(lockstat) end
+EOF
+pass;
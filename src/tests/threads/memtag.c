@@ -0,0 +1,51 @@
+/** Checks memory tag accounting.  Blocks from malloc_tagged() and
+   pages from palloc with PAL_TAG are charged to their tag, a block
+   keeps its tag across realloc(), and freeing everything credits
+   every byte back. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/memtag.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+#define BLOCK_CNT 10
+
+void
+test_memtag (void) 
+{
+  struct memtag_stats before, during, after;
+  void *blocks[BLOCK_CNT];
+  void *pages;
+  int i;
+
+  memtag_get_stats (MEM_OTHER, &before);
+  for (i = 0; i < BLOCK_CNT; i++)
+    blocks[i] = malloc_tagged (100, MEM_OTHER);
+  pages = palloc_get_multiple (PAL_ASSERT | PAL_TAG (MEM_OTHER), 3);
+  memtag_get_stats (MEM_OTHER, &during);
+  msg ("Live bytes counted: %s.",
+       during.live - before.live == BLOCK_CNT * 128 + 3 * PGSIZE
+       && during.alloc_cnt - before.alloc_cnt == BLOCK_CNT + 1
+       ? "yes" : "no");
+
+  blocks[0] = realloc (blocks[0], 300);
+  memtag_get_stats (MEM_OTHER, &during);
+  msg ("Realloc kept the tag: %s.",
+       during.live - before.live == (BLOCK_CNT - 1) * 128 + 512 + 3 * PGSIZE
+       ? "yes" : "no");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  palloc_free_multiple (pages, 3);
+  memtag_get_stats (MEM_OTHER, &after);
+  msg ("All memory credited back: %s.",
+       after.live == before.live
+       && after.alloc_cnt - before.alloc_cnt == BLOCK_CNT + 2
+       && after.free_cnt - before.free_cnt == BLOCK_CNT + 2
+       ? "yes" : "no");
+  msg ("Peak recorded: %s.",
+       after.peak >= before.live + (BLOCK_CNT - 1) * 128 + 512 + 3 * PGSIZE
+       ? "yes" : "no");
+}
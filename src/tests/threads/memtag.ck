@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(memtag) begin
+(memtag) Live bytes counted: yes.
+(memtag) Realloc kept the tag: yes.
+(memtag) All memory credited back: yes.
+(memtag) Peak recorded: yes.
+(memtag) end
+EOF
+pass;
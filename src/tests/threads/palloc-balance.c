@@ -0,0 +1,49 @@
+/** Checks that the user pool borrows from the kernel pool.  Takes
+   user pages until none are left, which should be more than the
+   user pool started with, while the kernel pool still has pages
+   of its own.  Then frees the user pages in the order they were
+   taken, and each chunk the user pool borrowed should go back to
+   the kernel pool once it is wholly free. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+
+void
+test_palloc_balance (void) 
+{
+  struct palloc_stats before, after;
+  void *head = NULL;
+  void **tail = &head;
+  void *page;
+  size_t cnt = 0;
+
+  palloc_get_stats (PAL_USER, &before);
+
+  /* Link the pages in order through their first words. */
+  while ((page = palloc_get_page (PAL_USER)) != NULL) 
+    {
+      *tail = page;
+      tail = page;
+      *tail = NULL;
+      cnt++;
+    }
+  msg ("Took more pages than the user pool started with: %s.",
+       cnt > before.page_cnt ? "yes" : "no");
+
+  page = palloc_get_page (0);
+  msg ("Kernel pool kept pages in reserve: %s.",
+       page != NULL ? "yes" : "no");
+  palloc_free_page (page);
+
+  while (head != NULL) 
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+  palloc_get_stats (PAL_USER, &after);
+  msg ("Borrowed pages returned: %s.",
+       after.borrowed_cnt == 0 && after.page_cnt == before.page_cnt
+       ? "yes" : "no");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-balance) begin
+(palloc-balance) Took more pages than the user pool started with: yes.
+(palloc-balance) Kernel pool kept pages in reserve: yes.
+(palloc-balance) Borrowed pages returned: yes.
+(palloc-balance) end
+EOF
+pass;
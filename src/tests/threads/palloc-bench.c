@@ -0,0 +1,80 @@
+/** Measures the page allocator on a mix of single-page and
+   multi-page requests.  Each round fills a set of slots with
+   allocations of 1 to 8 pages, mostly single pages, then
+   repeatedly frees a pseudo-random slot and refills it with an
+   allocation of a new size, which fragments the pool.  At the end
+   every slot is freed, and the pool must have coalesced back to
+   the free block sizes it started with. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "devices/tsc.h"
+
+#define SLOT_CNT 48
+#define ROUNDS 20
+#define CHURN 200
+
+/** Returns the next value from a linear congruential generator. */
+static unsigned
+next_rand (unsigned *state) 
+{
+  *state = *state * 1103515245 + 12345;
+  return *state >> 16;
+}
+
+/** Returns a request size: one page three times in four, otherwise
+   2 to 8 pages. */
+static size_t
+pick_size (unsigned *state) 
+{
+  unsigned r = next_rand (state);
+  return r % 4 != 0 ? 1 : 2 + r / 4 % 7;
+}
+
+void
+test_palloc_bench (void) 
+{
+  static void *pages[SLOT_CNT];
+  static size_t sizes[SLOT_CNT];
+  struct palloc_stats before, after;
+  unsigned state = 1;
+  unsigned long ops = 0;
+  uint64_t start;
+  int round, i;
+
+  palloc_get_stats (0, &before);
+  start = tsc_read ();
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      for (i = 0; i < SLOT_CNT; i++) 
+        {
+          sizes[i] = pick_size (&state);
+          pages[i] = palloc_get_multiple (PAL_ASSERT, sizes[i]);
+          ops++;
+        }
+      for (i = 0; i < CHURN; i++) 
+        {
+          int slot = next_rand (&state) % SLOT_CNT;
+          palloc_free_multiple (pages[slot], sizes[slot]);
+          sizes[slot] = pick_size (&state);
+          pages[slot] = palloc_get_multiple (PAL_ASSERT, sizes[slot]);
+          ops += 2;
+        }
+      for (i = 0; i < SLOT_CNT; i++) 
+        {
+          palloc_free_multiple (pages[i], sizes[i]);
+          ops++;
+        }
+    }
+  palloc_get_stats (0, &after);
+
+  msg ("Ran %lu allocations and frees.", ops);
+  msg ("%"PRIu64" cycles per operation.", (tsc_read () - start) / ops);
+  msg ("Free pages restored: %s.",
+       after.free_cnt == before.free_cnt ? "yes" : "no");
+  msg ("Largest free block restored: %s.",
+       after.largest_free == before.largest_free ? "yes" : "no");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings differ from run to run, so only check that they were
+# reported.
+fail "No timing reported.\n" if !grep (/\d+ cycles per operation/, @output);
+@output = grep (!/cycles per operation/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-bench) begin
+(palloc-bench) Ran 9920 allocations and frees.
+(palloc-bench) Free pages restored: yes.
+(palloc-bench) Largest free block restored: yes.
+(palloc-bench) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/** Checks the pre-zeroed page pool.  While the main thread sleeps,
+   the idle thread should fill the kernel pool's pre-zeroed pages.
+   Each of those should then serve a PAL_ZERO request as a hit,
+   with every byte zero, and the next request should miss, since
+   the idle thread does not run again in between. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGE_MAX 64
+
+/** Returns true if all of PAGE is zero. */
+static bool
+page_is_zero (const void *page) 
+{
+  const uint32_t *p = page;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_palloc_zero (void) 
+{
+  struct palloc_stats before, after;
+  void *pages[PAGE_MAX + 1];
+  bool all_zero = true;
+  size_t i, cnt;
+
+  timer_sleep (20);
+  palloc_get_stats (0, &before);
+  msg ("Idle thread zeroed pages ahead: %s.",
+       before.zeroed_cnt > 0 ? "yes" : "no");
+
+  cnt = before.zeroed_cnt < PAGE_MAX ? before.zeroed_cnt : PAGE_MAX;
+  for (i = 0; i <= cnt; i++) 
+    {
+      pages[i] = palloc_get_page (PAL_ZERO | PAL_ASSERT);
+      if (!page_is_zero (pages[i]))
+        all_zero = false;
+    }
+  palloc_get_stats (0, &after);
+
+  msg ("Every page zero: %s.", all_zero ? "yes" : "no");
+  msg ("Pre-zeroed pages served as hits: %s.",
+       after.zero_hits - before.zero_hits == cnt ? "yes" : "no");
+  msg ("Next request missed: %s.",
+       after.zero_misses - before.zero_misses == 1 ? "yes" : "no");
+
+  for (i = 0; i <= cnt; i++)
+    palloc_free_page (pages[i]);
+}
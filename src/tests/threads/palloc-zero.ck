@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) Idle thread zeroed pages ahead: yes.
+(palloc-zero) Every page zero: yes.
+(palloc-zero) Pre-zeroed pages served as hits: yes.
+(palloc-zero) Next request missed: yes.
+(palloc-zero) end
+EOF
+pass;
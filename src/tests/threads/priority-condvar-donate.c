@@ -0,0 +1,77 @@
+/** Tests that a thread waiting in cond_wait() moves up the
+   condition's queue when it receives a priority donation.
+
+   Two threads wait on a condition: "mid" at PRI_DEFAULT + 2, and
+   "low" at PRI_DEFAULT + 1, which also holds a second lock.  A
+   "donor" thread at PRI_DEFAULT + 5 then blocks on that lock,
+   raising "low" above "mid" while it waits.  The first signal
+   must therefore wake "low". */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func mid_thread_func;
+static thread_func low_thread_func;
+static thread_func donor_thread_func;
+static struct lock lock;
+static struct lock held;
+static struct condition condition;
+
+void
+test_priority_condvar_donate (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  lock_init (&held);
+  cond_init (&condition);
+
+  thread_create ("mid", PRI_DEFAULT + 2, mid_thread_func, NULL);
+  thread_create ("low", PRI_DEFAULT + 1, low_thread_func, NULL);
+  thread_create ("donor", PRI_DEFAULT + 5, donor_thread_func, NULL);
+
+  for (i = 0; i < 2; i++) 
+    {
+      lock_acquire (&lock);
+      msg ("Signaling...");
+      cond_signal (&condition, &lock);
+      lock_release (&lock);
+    }
+}
+
+static void
+mid_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+low_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&held);
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+  lock_release (&held);
+}
+
+static void
+donor_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&held);
+  msg ("Thread %s got lock.", thread_name ());
+  lock_release (&held);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-donate) begin
+(priority-condvar-donate) Thread mid starting.
+(priority-condvar-donate) Thread low starting.
+(priority-condvar-donate) Thread donor starting.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread low woke up.
+(priority-condvar-donate) Thread donor got lock.
+(priority-condvar-donate) Signaling...
+(priority-condvar-donate) Thread mid woke up.
+(priority-condvar-donate) end
+EOF
+pass;
@@ -0,0 +1,76 @@
+/** Tests that a thread waiting in cond_wait() moves down the
+   condition's queue when a donation it received is withdrawn
+   after it joined the queue.
+
+   "mid", at PRI_DEFAULT + 3, waits on a condition first.  "low",
+   at PRI_DEFAULT + 1, then acquires the condition's lock and
+   creates a "donor" at PRI_DEFAULT + 5 that blocks on it, so
+   "low" joins the condition's queue ahead of "mid" at the donated
+   priority.  Releasing the lock inside cond_wait() withdraws the
+   donation while "low" is still running, dropping it below
+   "mid".  The first signal must therefore wake "mid". */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func mid_thread_func;
+static thread_func low_thread_func;
+static thread_func donor_thread_func;
+static struct lock lock;
+static struct condition condition;
+
+void
+test_priority_condvar_recall (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lock_init (&lock);
+  cond_init (&condition);
+
+  thread_create ("mid", PRI_DEFAULT + 3, mid_thread_func, NULL);
+  thread_create ("low", PRI_DEFAULT + 1, low_thread_func, NULL);
+
+  for (i = 0; i < 2; i++) 
+    {
+      lock_acquire (&lock);
+      msg ("Signaling...");
+      cond_signal (&condition, &lock);
+      lock_release (&lock);
+    }
+}
+
+static void
+mid_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&lock);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+low_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&lock);
+  thread_create ("donor", PRI_DEFAULT + 5, donor_thread_func, NULL);
+  cond_wait (&condition, &lock);
+  msg ("Thread %s woke up.", thread_name ());
+  lock_release (&lock);
+}
+
+static void
+donor_thread_func (void *aux UNUSED) 
+{
+  msg ("Thread %s starting.", thread_name ());
+  lock_acquire (&lock);
+  msg ("Thread %s got lock.", thread_name ());
+  lock_release (&lock);
+}
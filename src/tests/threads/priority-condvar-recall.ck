@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-recall) begin
+(priority-condvar-recall) Thread mid starting.
+(priority-condvar-recall) Thread low starting.
+(priority-condvar-recall) Thread donor starting.
+(priority-condvar-recall) Thread donor got lock.
+(priority-condvar-recall) Signaling...
+(priority-condvar-recall) Thread mid woke up.
+(priority-condvar-recall) Signaling...
+(priority-condvar-recall) Thread low woke up.
+(priority-condvar-recall) end
+EOF
+pass;
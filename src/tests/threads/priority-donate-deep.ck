@@ -0,0 +1,71 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-deep) begin
+(priority-donate-deep) main got lock.
+(priority-donate-deep) main should have priority 1.  Actual priority: 1.
+(priority-donate-deep) main should have priority 2.  Actual priority: 2.
+(priority-donate-deep) main should have priority 3.  Actual priority: 3.
+(priority-donate-deep) main should have priority 4.  Actual priority: 4.
+(priority-donate-deep) main should have priority 5.  Actual priority: 5.
+(priority-donate-deep) main should have priority 6.  Actual priority: 6.
+(priority-donate-deep) main should have priority 7.  Actual priority: 7.
+(priority-donate-deep) main should have priority 8.  Actual priority: 8.
+(priority-donate-deep) main should have priority 9.  Actual priority: 9.
+(priority-donate-deep) main should have priority 10.  Actual priority: 10.
+(priority-donate-deep) main should have priority 11.  Actual priority: 11.
+(priority-donate-deep) main should have priority 12.  Actual priority: 12.
+(priority-donate-deep) main should have priority 13.  Actual priority: 13.
+(priority-donate-deep) main should have priority 14.  Actual priority: 14.
+(priority-donate-deep) main should have priority 15.  Actual priority: 15.
+(priority-donate-deep) main should have priority 16.  Actual priority: 16.
+(priority-donate-deep) main should have priority 17.  Actual priority: 17.
+(priority-donate-deep) main should have priority 18.  Actual priority: 18.
+(priority-donate-deep) main should have priority 19.  Actual priority: 19.
+(priority-donate-deep) main should have priority 20.  Actual priority: 20.
+(priority-donate-deep) thread 1 got lock
+(priority-donate-deep) thread 2 got lock
+(priority-donate-deep) thread 3 got lock
+(priority-donate-deep) thread 4 got lock
+(priority-donate-deep) thread 5 got lock
+(priority-donate-deep) thread 6 got lock
+(priority-donate-deep) thread 7 got lock
+(priority-donate-deep) thread 8 got lock
+(priority-donate-deep) thread 9 got lock
+(priority-donate-deep) thread 10 got lock
+(priority-donate-deep) thread 11 got lock
+(priority-donate-deep) thread 12 got lock
+(priority-donate-deep) thread 13 got lock
+(priority-donate-deep) thread 14 got lock
+(priority-donate-deep) thread 15 got lock
+(priority-donate-deep) thread 16 got lock
+(priority-donate-deep) thread 17 got lock
+(priority-donate-deep) thread 18 got lock
+(priority-donate-deep) thread 19 got lock
+(priority-donate-deep) thread 20 got lock
+(priority-donate-deep) thread 20 finishing with priority 20.
+(priority-donate-deep) thread 19 finishing with priority 19.
+(priority-donate-deep) thread 18 finishing with priority 18.
+(priority-donate-deep) thread 17 finishing with priority 17.
+(priority-donate-deep) thread 16 finishing with priority 16.
+(priority-donate-deep) thread 15 finishing with priority 15.
+(priority-donate-deep) thread 14 finishing with priority 14.
+(priority-donate-deep) thread 13 finishing with priority 13.
+(priority-donate-deep) thread 12 finishing with priority 12.
+(priority-donate-deep) thread 11 finishing with priority 11.
+(priority-donate-deep) thread 10 finishing with priority 10.
+(priority-donate-deep) thread 9 finishing with priority 9.
+(priority-donate-deep) thread 8 finishing with priority 8.
+(priority-donate-deep) thread 7 finishing with priority 7.
+(priority-donate-deep) thread 6 finishing with priority 6.
+(priority-donate-deep) thread 5 finishing with priority 5.
+(priority-donate-deep) thread 4 finishing with priority 4.
+(priority-donate-deep) thread 3 finishing with priority 3.
+(priority-donate-deep) thread 2 finishing with priority 2.
+(priority-donate-deep) thread 1 finishing with priority 1.
+(priority-donate-deep) main finishing with priority 0.
+(priority-donate-deep) end
+EOF
+pass;
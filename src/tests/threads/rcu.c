@@ -0,0 +1,58 @@
+/** Checks the RCU primitives.  A call_rcu() callback queued before
+   synchronize_rcu() has run by the time it returns.  Then the main
+   thread spins inside a read-side critical section for several
+   time slices while another thread of the same priority is ready:
+   the timer's preemption is deferred until rcu_read_unlock(),
+   which yields to the other thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/rcu.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static rcu_func callback;
+static thread_func other_thread;
+static volatile bool callback_ran;
+static volatile bool other_ran;
+
+void
+test_rcu (void) 
+{
+  struct rcu_head head;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  call_rcu (&head, callback);
+  synchronize_rcu ();
+  msg ("Callback ran before synchronize_rcu() returned: %s.",
+       callback_ran ? "yes" : "no");
+
+  thread_create ("other", PRI_DEFAULT, other_thread, NULL);
+
+  rcu_read_lock ();
+  start = timer_ticks ();
+  while (timer_elapsed (start) < 20)
+    continue;
+  msg ("Other thread ran inside the critical section: %s.",
+       other_ran ? "yes" : "no");
+  rcu_read_unlock ();
+
+  msg ("Other thread ran after rcu_read_unlock(): %s.",
+       other_ran ? "yes" : "no");
+}
+
+static void
+callback (struct rcu_head *head UNUSED) 
+{
+  callback_ran = true;
+}
+
+static void
+other_thread (void *aux UNUSED) 
+{
+  other_ran = true;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rcu) begin
+(rcu) Callback ran before synchronize_rcu() returned: yes.
+(rcu) Other thread ran inside the critical section: no.
+(rcu) Other thread ran after rcu_read_unlock(): yes.
+(rcu) end
+EOF
+pass;
@@ -0,0 +1,135 @@
+/** Checks the shrinkers.  The test keeps a cache of kernel pages
+   behind a shrinker of its own.  With the user pool used up,
+   taking kernel pages until free memory is below the low
+   watermark should wake the reclaimer thread, which should then
+   empty the cache while the test sleeps.  Refilled, the cache
+   should also be emptied before a kernel allocation fails. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define CACHE_PAGES 8
+
+/** The test's cache: pages linked through their first words.
+   The test thread and the reclaimer both take pages from it, so it
+   is accessed with interrupts off. */
+static void *cache;
+static size_t cache_cnt;
+
+/** Pages the reclaimer thread freed from the cache. */
+static size_t reclaimer_freed;
+
+static size_t
+cache_count (void *aux UNUSED) 
+{
+  return cache_cnt;
+}
+
+static size_t
+cache_scan (size_t nr, void *aux UNUSED) 
+{
+  size_t freed;
+
+  for (freed = 0; freed < nr; freed++) 
+    {
+      enum intr_level old_level = intr_disable ();
+      void *page = cache;
+
+      if (page != NULL) 
+        {
+          cache = *(void **) page;
+          cache_cnt--;
+        }
+      intr_set_level (old_level);
+
+      if (page == NULL)
+        break;
+      palloc_free_page (page);
+    }
+  if (!strcmp (thread_name (), "kreclaimd"))
+    reclaimer_freed += freed;
+  return freed;
+}
+
+/** Pushes PAGE onto the list at *LIST. */
+static void
+push (void **list, void *page) 
+{
+  *(void **) page = *list;
+  *list = page;
+}
+
+/** Frees every page on the list at *LIST. */
+static void
+free_all (void **list) 
+{
+  while (*list != NULL) 
+    {
+      void *page = *list;
+      *list = *(void **) page;
+      palloc_free_page (page);
+    }
+}
+
+/** Fills the cache with CACHE_PAGES kernel pages. */
+static void
+fill_cache (void) 
+{
+  while (cache_cnt < CACHE_PAGES) 
+    {
+      void *page = palloc_get_page (PAL_ASSERT);
+      enum intr_level old_level = intr_disable ();
+
+      push (&cache, page);
+      cache_cnt++;
+      intr_set_level (old_level);
+    }
+}
+
+void
+test_reclaim (void) 
+{
+  static struct shrinker shrinker;
+  void *user_pages = NULL;
+  void *kernel_pages = NULL;
+  void *page;
+  bool failed = false;
+
+  shrinker_register (&shrinker, "reclaim test", cache_count, cache_scan,
+                     NULL);
+
+  while ((page = palloc_get_page (PAL_USER)) != NULL)
+    push (&user_pages, page);
+
+  fill_cache ();
+  while (!palloc_below_watermark (false)) 
+    {
+      page = palloc_get_page (0);
+      if (page == NULL) 
+        {
+          failed = true;
+          break;
+        }
+      push (&kernel_pages, page);
+    }
+  msg ("Reached the low watermark: %s.", !failed ? "yes" : "no");
+
+  timer_sleep (10);
+  msg ("Reclaimer emptied the cache: %s.",
+       cache_cnt == 0 && reclaimer_freed == CACHE_PAGES ? "yes" : "no");
+
+  fill_cache ();
+  while ((page = palloc_get_page (0)) != NULL)
+    push (&kernel_pages, page);
+  msg ("Cache emptied before allocation failed: %s.",
+       cache_cnt == 0 ? "yes" : "no");
+
+  free_all (&kernel_pages);
+  free_all (&user_pages);
+}
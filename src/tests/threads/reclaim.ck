@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(reclaim) begin
+(reclaim) Reached the low watermark: yes.
+(reclaim) Reclaimer emptied the cache: yes.
+(reclaim) Cache emptied before allocation failed: yes.
+(reclaim) end
+EOF
+pass;
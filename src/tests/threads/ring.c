@@ -0,0 +1,87 @@
+/** Passes a byte stream through a ring buffer from a
+   higher-priority producer thread to the main thread.  The
+   producer writes in chunks of varying size and sleeps whenever
+   the ring is full; the consumer reads in chunks of another size
+   and sleeps whenever it is empty.  Every byte must arrive once,
+   in order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/ring.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/** Bytes to pass through the ring. */
+#define STREAM_SIZE 10000
+
+static thread_func producer;
+static struct ring ring;
+static struct semaphore done;
+
+/** Returns the byte at offset OFS in the stream. */
+static uint8_t
+stream_byte (size_t ofs) 
+{
+  return (ofs * 7 + ofs / 251) & 0xff;
+}
+
+void
+test_ring (void) 
+{
+  uint8_t buf[37];
+  size_t ofs = 0;
+  size_t mismatches = 0;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  ring_init (&ring);
+  sema_init (&done, 0);
+  thread_create ("producer", PRI_DEFAULT + 1, producer, NULL);
+  msg ("Producer filled the ring: %s.", ring_full (&ring) ? "yes" : "no");
+
+  while (ofs < STREAM_SIZE) 
+    {
+      size_t cnt, i;
+
+      ring_wait_data (&ring);
+      cnt = ring_get (&ring, buf, sizeof buf);
+      if (cnt == 0)
+        fail ("ring_get() returned no data after ring_wait_data()");
+      for (i = 0; i < cnt; i++)
+        if (buf[i] != stream_byte (ofs + i))
+          mismatches++;
+      ofs += cnt;
+    }
+  sema_down (&done);
+
+  msg ("Received %zu bytes, %zu out of place.", ofs, mismatches);
+  msg ("Ring empty at end: %s.", ring_empty (&ring) ? "yes" : "no");
+}
+
+static void
+producer (void *aux UNUSED) 
+{
+  uint8_t buf[100];
+  size_t ofs = 0;
+  size_t chunk = 1;
+
+  while (ofs < STREAM_SIZE) 
+    {
+      size_t cnt, i;
+
+      if (chunk > sizeof buf || ofs + chunk > STREAM_SIZE)
+        chunk = 1;
+      if (ofs + chunk > STREAM_SIZE)
+        chunk = STREAM_SIZE - ofs;
+      for (i = 0; i < chunk; i++)
+        buf[i] = stream_byte (ofs + i);
+
+      ring_wait_space (&ring);
+      cnt = ring_put (&ring, buf, chunk);
+      ofs += cnt;
+      chunk += 13;
+    }
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring) begin
+(ring) Producer filled the ring: yes.
+(ring) Received 10000 bytes, 0 out of place.
+(ring) Ring empty at end: yes.
+(ring) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/** Measures an object cache whose usage swings back and forth
+   across slab boundaries.  Each round allocates enough objects to
+   fill two slabs and start a third, then frees them all, which
+   empties all three.  The cache should keep the empty slabs and
+   reuse them in the next round, rather than give their pages back
+   to the page allocator and take new ones each time. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+#include "devices/tsc.h"
+
+#define OBJ_SIZE 128
+#define OBJ_MAX (2 * (PGSIZE / OBJ_SIZE) + 1)
+#define ROUNDS 1000
+
+/** Returns the number of free pages in the kernel pool. */
+static size_t
+free_pages (void) 
+{
+  struct palloc_stats stats;
+
+  palloc_get_stats (0, &stats);
+  return stats.free_cnt + stats.zeroed_cnt;
+}
+
+void
+test_slab_boundary (void) 
+{
+  static struct kmem_cache cache;
+  static void *objs[OBJ_MAX];
+  size_t obj_cnt, free_cnt;
+  int churn_cnt = 0;
+  uint64_t start;
+  size_t i;
+  int round;
+
+  kmem_cache_init (&cache, "boundary", OBJ_SIZE, NULL, MEM_OTHER);
+  obj_cnt = 2 * cache.objs_per_slab + 1;
+  ASSERT (obj_cnt <= OBJ_MAX);
+
+  /* Create the slabs once. */
+  for (i = 0; i < obj_cnt; i++)
+    if ((objs[i] = kmem_cache_alloc (&cache)) == NULL)
+      fail ("allocation %zu failed", i);
+  msg ("%zu objects span %zu slabs.", obj_cnt, cache.slab_cnt);
+  for (i = 0; i < obj_cnt; i++)
+    kmem_cache_free (&cache, objs[i]);
+  free_cnt = free_pages ();
+
+  start = tsc_read ();
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      bool churned;
+
+      for (i = 0; i < obj_cnt; i++)
+        if ((objs[i] = kmem_cache_alloc (&cache)) == NULL)
+          fail ("allocation %zu failed in round %d", i, round);
+      churned = free_pages () != free_cnt;
+      for (i = 0; i < obj_cnt; i++)
+        kmem_cache_free (&cache, objs[i]);
+      if (churned || free_pages () != free_cnt)
+        churn_cnt++;
+    }
+  msg ("%"PRIu64" cycles per round.", (tsc_read () - start) / ROUNDS);
+
+  msg ("Rounds that allocated or freed pages: %d.", churn_cnt);
+  msg ("Slabs kept after %d rounds: %zu.", ROUNDS, cache.slab_cnt);
+  kmem_cache_shrink (&cache);
+}
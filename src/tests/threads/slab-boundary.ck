@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings differ from run to run, so only check that they were
+# reported.
+fail "No timing reported.\n" if !grep (/\d+ cycles per round/, @output);
+@output = grep (!/cycles per round/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(slab-boundary) begin
+(slab-boundary) 63 objects span 3 slabs.
+(slab-boundary) Rounds that allocated or freed pages: 0.
+(slab-boundary) Slabs kept after 1000 rounds: 3.
+(slab-boundary) end
+EOF
+pass;
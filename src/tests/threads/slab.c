@@ -0,0 +1,75 @@
+/** Checks an object cache with a constructor.  Allocates enough
+   objects to fill several slabs and checks that they are distinct,
+   aligned, and constructed once each.  Checks that a freed object
+   is the next one handed out, then frees everything and checks
+   that the cache keeps its empty slabs, which kmem_cache_shrink()
+   gives back. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 100
+
+struct object 
+  {
+    unsigned magic;
+    char payload[92];
+  };
+
+#define OBJECT_MAGIC 0x0b1ec7
+
+static kmem_ctor construct;
+static int ctor_cnt;
+
+void
+test_slab (void) 
+{
+  static struct kmem_cache cache;
+  static struct object *objs[OBJ_CNT];
+  size_t bad = 0;
+  size_t slabs;
+  void *reused;
+  int i, j;
+
+  kmem_cache_init (&cache, "test", sizeof (struct object), construct,
+                   MEM_OTHER);
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = kmem_cache_alloc (&cache);
+      if (objs[i] == NULL)
+        fail ("allocation %d failed", i);
+      if (objs[i]->magic != OBJECT_MAGIC || (uintptr_t) objs[i] % 8 != 0)
+        bad++;
+      for (j = 0; j < i; j++)
+        if (objs[j] == objs[i])
+          bad++;
+    }
+  slabs = cache.slab_cnt;
+  msg ("%d objects in %zu slabs, %zu bad.", OBJ_CNT, slabs, bad);
+  msg ("Constructor ran once per object in each slab: %s.",
+       (size_t) ctor_cnt == slabs * cache.objs_per_slab ? "yes" : "no");
+
+  kmem_cache_free (&cache, objs[OBJ_CNT / 2]);
+  reused = kmem_cache_alloc (&cache);
+  msg ("Freed object reused first: %s.",
+       reused == objs[OBJ_CNT / 2] ? "yes" : "no");
+
+  for (i = 0; i < OBJ_CNT; i++)
+    kmem_cache_free (&cache, objs[i]);
+  msg ("After freeing everything: %zu objects in use, %zu slabs kept.",
+       cache.active_cnt, cache.slab_cnt);
+  msg ("Shrinking freed %zu pages, leaving %zu slabs.",
+       kmem_cache_shrink (&cache), cache.slab_cnt);
+}
+
+static void
+construct (void *obj_) 
+{
+  struct object *obj = obj_;
+
+  obj->magic = OBJECT_MAGIC;
+  ctor_cnt++;
+}
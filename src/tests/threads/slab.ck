@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) 100 objects in 3 slabs, 0 bad.
+(slab) Constructor ran once per object in each slab: yes.
+(slab) Freed object reused first: yes.
+(slab) After freeing everything: 0 objects in use, 3 slabs kept.
+(slab) Shrinking freed 3 pages, leaving 0 slabs.
+(slab) end
+EOF
+pass;
@@ -17,6 +17,8 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
+    {"alarm-hrsleep", test_alarm_hrsleep},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,10 +27,13 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-deep", test_priority_donate_deep},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-condvar-donate", test_priority_condvar_donate},
+    {"priority-condvar-recall", test_priority_condvar_recall},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +43,31 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"workqueue", test_workqueue},
+    {"fpu-lazy", test_fpu_lazy},
+    {"thread-create-bench", test_thread_create_bench},
+    {"stride-fair-2", test_stride_fair_2},
+    {"stride-fair-20", test_stride_fair_20},
+    {"stride-tickets-2", test_stride_tickets_2},
+    {"stride-tickets-10", test_stride_tickets_10},
+    {"cfs-fair-2", test_cfs_fair_2},
+    {"cfs-fair-20", test_cfs_fair_20},
+    {"cfs-nice-2", test_cfs_nice_2},
+    {"cfs-nice-10", test_cfs_nice_10},
+    {"edf-admit", test_edf_admit},
+    {"edf-deadline-load", test_edf_deadline_load},
+    {"edf-deadline-overrun", test_edf_deadline_overrun},
+    {"lockstat", test_lockstat},
+    {"rcu", test_rcu},
+    {"ring", test_ring},
+    {"palloc-bench", test_palloc_bench},
+    {"bitmap-scan", test_bitmap_scan},
+    {"slab", test_slab},
+    {"slab-boundary", test_slab_boundary},
+    {"palloc-zero", test_palloc_zero},
+    {"palloc-balance", test_palloc_balance},
+    {"reclaim", test_reclaim},
+    {"memtag", test_memtag},
   };
 
 static const char *test_name;
@@ -11,6 +11,8 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
+extern test_func test_alarm_hrsleep;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,10 +21,13 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_deep;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_priority_condvar_donate;
+extern test_func test_priority_condvar_recall;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +37,31 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_workqueue;
+extern test_func test_fpu_lazy;
+extern test_func test_thread_create_bench;
+extern test_func test_stride_fair_2;
+extern test_func test_stride_fair_20;
+extern test_func test_stride_tickets_2;
+extern test_func test_stride_tickets_10;
+extern test_func test_cfs_fair_2;
+extern test_func test_cfs_fair_20;
+extern test_func test_cfs_nice_2;
+extern test_func test_cfs_nice_10;
+extern test_func test_edf_admit;
+extern test_func test_edf_deadline_load;
+extern test_func test_edf_deadline_overrun;
+extern test_func test_lockstat;
+extern test_func test_rcu;
+extern test_func test_ring;
+extern test_func test_palloc_bench;
+extern test_func test_bitmap_scan;
+extern test_func test_slab;
+extern test_func test_slab_boundary;
+extern test_func test_palloc_zero;
+extern test_func test_palloc_balance;
+extern test_func test_reclaim;
+extern test_func test_memtag;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
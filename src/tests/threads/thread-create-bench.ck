@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# Timings differ from run to run, so only check that they were
+# reported, and that almost every page came from the cache.
+my ($line) = grep (/cycles per thread/, @output);
+fail "No timing reported.\n" if !defined $line;
+my ($hits, $misses)
+  = $line =~ /\d+ cycles per thread, (\d+) page cache hits, (\d+) misses/
+  or fail "Malformed timing line: $line\n";
+fail "Only $hits of 2000 thread pages came from the cache.\n"
+  if $hits < 1990;
+@output = grep (!/cycles per thread/, @output);
+
+compare_output ("run", \@output, [<<'EOF']);
+(thread-create-bench) begin
+(thread-create-bench) Created and exited 2000 threads.
+(thread-create-bench) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/** Tests the deferred-work queue.  Work queued by a thread that
+   the worker cannot preempt must run as one batch, in order, once
+   that thread blocks.  Queuing an item that is still pending must
+   be refused, and an item must be able to requeue itself from its
+   own function. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+#define ITEM_CNT 3
+#define REQUEUE_CNT 3
+
+static work_func record_work;
+static work_func requeue_work;
+
+static int order[ITEM_CNT];
+static int order_cnt;
+static int requeue_runs;
+static struct semaphore done;
+
+void
+test_workqueue (void) 
+{
+  struct work items[ITEM_CNT];
+  struct work requeue;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Run at the workers' priority so that they do not preempt us. */
+  thread_set_priority (PRI_MAX);
+
+  sema_init (&done, 0);
+  for (i = 0; i < ITEM_CNT; i++)
+    work_init (&items[i], record_work, (void *) i);
+
+  for (i = 0; i < ITEM_CNT; i++)
+    work_schedule (&items[i]);
+  if (work_schedule (&items[0]))
+    fail ("pending item was queued twice");
+
+  for (i = 0; i < ITEM_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < order_cnt; i++)
+    msg ("item %d ran", order[i]);
+
+  work_init (&requeue, requeue_work, &requeue);
+  work_schedule (&requeue);
+  sema_down (&done);
+  msg ("requeued item ran %d times", requeue_runs);
+}
+
+static void
+record_work (void *aux) 
+{
+  order[order_cnt++] = (int) aux;
+  sema_up (&done);
+}
+
+static void
+requeue_work (void *w) 
+{
+  if (++requeue_runs == REQUEUE_CNT)
+    sema_up (&done);
+  else if (!work_schedule (w))
+    fail ("running item could not requeue itself");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) item 0 ran
+(workqueue) item 1 ran
+(workqueue) item 2 ran
+(workqueue) requeued item ran 3 times
+(workqueue) end
+EOF
+pass;
@@ -0,0 +1,34 @@
+/** Checks an 8 MB uninitialized array, which spans at least one
+   4 MB-aligned stretch of the address space.  The loader may map
+   such a stretch with a single large page, and the rest with
+   4 kB pages; either way, the array must start out zeroed and
+   read back what was written to each of its pages. */
+
+#include <stddef.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (8 * 1024 * 1024)
+#define PAGE 4096
+
+static unsigned char buf[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  msg ("zero pass");
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu != 0", i);
+
+  msg ("write pass");
+  for (i = 0; i < SIZE; i += PAGE)
+    buf[i + i / PAGE % PAGE] = i / PAGE % 251 + 1;
+
+  msg ("read pass");
+  for (i = 0; i < SIZE; i += PAGE)
+    if (buf[i + i / PAGE % PAGE] != i / PAGE % 251 + 1)
+      fail ("page %zu read back wrong", i / PAGE);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(large-page) begin
+(large-page) zero pass
+(large-page) write pass
+(large-page) read pass
+(large-page) end
+large-page: exit(0)
+EOF
+pass;
@@ -0,0 +1,225 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/** Lazy FPU context switching.
+
+   The kernel itself is compiled with -msoft-float and never
+   touches the FPU, so only threads running user code (or test
+   code) that executes x87, MMX, or SSE instructions have FPU
+   state worth keeping.  Rather than saving and restoring that
+   state on every context switch, the registers are left loaded
+   with the state of whichever thread used them last, the
+   "owner", and CR0.TS is set while any other thread runs.  The
+   first FPU instruction such a thread executes then raises #NM
+   (device not available), and only then does the handler save
+   the owner's state and load the new thread's.
+
+   A thread gets a save area the first time it traps.  Threads
+   that never use the FPU pay nothing beyond a comparison in
+   fpu_switch(), since with no owner CR0.TS simply stays set. */
+
+/** CR0 bits. */
+#define CR0_MP 0x00000002       /**< Monitor coprocessor: WAIT honors TS. */
+#define CR0_EM 0x00000004       /**< Emulation: every FPU insn traps. */
+#define CR0_TS 0x00000008       /**< Task switched: next FPU insn traps. */
+#define CR0_NE 0x00000020       /**< Report FPU errors as #MF. */
+
+/** CR4 bits. */
+#define CR4_OSFXSR 0x00000200     /**< OS supports FXSAVE/FXRSTOR. */
+#define CR4_OSXMMEXCPT 0x00000400 /**< OS handles #XF. */
+
+/** CPUID leaf 1 EDX bits. */
+#define CPUID_FXSR (1u << 24)   /**< FXSAVE/FXRSTOR. */
+#define CPUID_SSE (1u << 25)    /**< SSE. */
+
+/** Size of a save area: enough for FXSAVE, which needs 16-byte
+   alignment, and more than enough for FNSAVE's 108 bytes. */
+#define FPU_AREA_SIZE 512
+
+static bool use_fxsr;           /**< FXSAVE, or fall back on FNSAVE? */
+static bool ts_set;             /**< Is CR0.TS set? */
+static struct thread *fpu_owner; /**< Thread whose state is loaded. */
+
+/** State after FNINIT, loaded by a thread's first FPU use. */
+static uint8_t initial_state[FPU_AREA_SIZE] __attribute__ ((aligned (16)));
+
+/** Save areas not in use, chained through their first word.
+   Carved out of whole pages, so they stay 16-byte aligned. */
+static void *free_areas;
+
+static intr_handler_func fpu_trap;
+static void *area_alloc (void);
+static void fpu_save (void *);
+static void fpu_restore (const void *);
+
+static inline uint32_t
+read_cr0 (void) 
+{
+  uint32_t cr0;
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  return cr0;
+}
+
+static inline void
+write_cr0 (uint32_t cr0) 
+{
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+}
+
+static inline void
+set_ts (void) 
+{
+  write_cr0 (read_cr0 () | CR0_TS);
+  ts_set = true;
+}
+
+static inline void
+clear_ts (void) 
+{
+  asm volatile ("clts");
+  ts_set = false;
+}
+
+/** Enables the FPU, and SSE where the CPU supports it, and
+   installs the #NM handler.  Must be called after intr_init()
+   and palloc_init(). */
+void
+fpu_init (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t cr4;
+
+  asm volatile ("cpuid"
+                : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  use_fxsr = (edx & CPUID_FXSR) != 0;
+
+  /* start.S turned on CR0.EM, which makes every FPU instruction
+     trap.  Use CR0.TS for that instead. */
+  write_cr0 ((read_cr0 () & ~CR0_EM) | CR0_MP | CR0_NE);
+  if (use_fxsr) 
+    {
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      cr4 |= CR4_OSFXSR;
+      if (edx & CPUID_SSE)
+        cr4 |= CR4_OSXMMEXCPT;
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+    }
+
+  asm volatile ("fninit");
+  fpu_save (initial_state);
+  set_ts ();
+
+  intr_register_int (7, 0, INTR_OFF, fpu_trap,
+                     "#NM Device Not Available Exception");
+}
+
+/** Called with interrupts off by thread_schedule_tail() just
+   after switching to NEXT.  Arranges for NEXT's first FPU
+   instruction to trap unless its state is already loaded. */
+void
+fpu_switch (struct thread *next) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (next == fpu_owner) 
+    {
+      if (ts_set)
+        clear_ts ();
+    }
+  else if (!ts_set)
+    set_ts ();
+}
+
+/** Releases dying thread T's FPU state and save area.
+   Interrupts must be off. */
+void
+fpu_release (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (fpu_owner == t)
+    fpu_owner = NULL;
+  if (t->fpu != NULL) 
+    {
+      *(void **) t->fpu = free_areas;
+      free_areas = t->fpu;
+      t->fpu = NULL;
+    }
+}
+
+/** #NM handler.  Saves the owner's FPU state and loads the
+   current thread's, which is the state after FNINIT if the
+   thread has never used the FPU before. */
+static void
+fpu_trap (struct intr_frame *f UNUSED) 
+{
+  struct thread *cur = thread_current ();
+
+  /* Allocate first: palloc may sleep, and another thread may
+     take the FPU meanwhile. */
+  if (cur->fpu == NULL)
+    cur->fpu = area_alloc ();
+
+  clear_ts ();
+  if (fpu_owner == cur)
+    return;
+  if (fpu_owner != NULL)
+    fpu_save (fpu_owner->fpu);
+  fpu_restore (cur->fpu);
+  fpu_owner = cur;
+}
+
+/** Returns a save area holding the initial FPU state.  Panics if
+   memory is exhausted. */
+static void *
+area_alloc (void) 
+{
+  uint8_t *area;
+
+  if (free_areas == NULL) 
+    {
+      uint8_t *page = palloc_get_page (PAL_ASSERT | PAL_TAG (MEM_FPU));
+      size_t ofs;
+
+      for (ofs = 0; ofs < PGSIZE; ofs += FPU_AREA_SIZE) 
+        {
+          *(void **) (page + ofs) = free_areas;
+          free_areas = page + ofs;
+        }
+    }
+  area = free_areas;
+  free_areas = *(void **) area;
+  memcpy (area, initial_state, FPU_AREA_SIZE);
+  return area;
+}
+
+/** Saves the FPU state into AREA. */
+static void
+fpu_save (void *area) 
+{
+  if (use_fxsr)
+    asm volatile ("fxsave %0" : "=m" (*(uint8_t (*)[FPU_AREA_SIZE]) area));
+  else
+    asm volatile ("fnsave %0" : "=m" (*(uint8_t (*)[FPU_AREA_SIZE]) area));
+}
+
+/** Loads the FPU state from AREA. */
+static void
+fpu_restore (const void *area) 
+{
+  if (use_fxsr)
+    asm volatile ("fxrstor %0"
+                  : : "m" (*(const uint8_t (*)[FPU_AREA_SIZE]) area));
+  else
+    asm volatile ("frstor %0"
+                  : : "m" (*(const uint8_t (*)[FPU_AREA_SIZE]) area));
+}
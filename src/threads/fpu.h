@@ -0,0 +1,10 @@
+#ifndef THREADS_FPU_H
+#define THREADS_FPU_H
+
+struct thread;
+
+void fpu_init (void);
+void fpu_switch (struct thread *next);
+void fpu_release (struct thread *);
+
+#endif /**< threads/fpu.h */
@@ -15,13 +15,16 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/shrinker.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -41,6 +44,15 @@
 /** Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/** True if 4 MB pages are enabled. */
+bool pse_enabled;
+
+/** CR4 bit that enables 4 MB pages. */
+#define CR4_PSE 0x00000010
+
+/** CPUID leaf 1 EDX bit for 4 MB page support. */
+#define CPUID_PSE (1u << 3)
+
 #ifdef FILESYS
 /** -f: Format the file system? */
 static bool format_filesys;
@@ -112,6 +124,8 @@ pintos_init (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  workqueue_init ();
+  fpu_init ();
   timer_init ();
   kbd_init ();
   input_init ();
@@ -122,6 +136,8 @@ pintos_init (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_start ();
+  reclaim_init ();
   serial_init_queue ();
   timer_calibrate ();
 
@@ -200,15 +216,35 @@ bss_init (void)
 /** Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports 4 MB pages, then each 4 MB of RAM that is
+   all present is mapped by a single large page, which saves a
+   page table and uses one TLB entry instead of 1,024.  The 4 MB
+   that hold the kernel's text still use 4 kB pages, so that the
+   text can stay read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
+  uint32_t eax, ebx, ecx, edx;
   size_t page;
   extern char _start, _end_kernel_text;
 
-  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  asm volatile ("cpuid"
+                : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                : "a" (1));
+  if (edx & CPUID_PSE)
+    {
+      uint32_t cr4;
+
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+      pse_enabled = true;
+    }
+
+  pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                        | PAL_TAG (MEM_PAGEDIR));
   pt = NULL;
   for (page = 0; page < init_ram_pages; page++)
     {
@@ -218,9 +254,19 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pse_enabled && pte_idx == 0
+          && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_large_kernel (vaddr, true);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
-          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+          pt = palloc_get_page (PAL_ASSERT | PAL_ZERO
+                                    | PAL_TAG (MEM_PAGEDIR));
           pd[pde_idx] = pde_create (pt);
         }
 
@@ -303,6 +349,18 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-stride"))
+        thread_stride = true;
+      else if (!strcmp (name, "-cfs"))
+        thread_cfs = true;
+      else if (!strcmp (name, "-lockstat"))
+        {
+          lockstat_enabled = true;
+          if (value != NULL)
+            lockstat_top = atoi (value);
+        }
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -311,6 +369,9 @@ parse_options (char **argv)
         PANIC ("unknown option `%s' (use -h for help)", name);
     }
 
+  if (thread_mlfqs + thread_stride + thread_cfs > 1)
+    PANIC ("-mlfqs, -stride, and -cfs are mutually exclusive");
+
   /* Initialize the random number generator based on the system
      time.  This has no effect if an "-rs" option was specified.
 
@@ -426,6 +487,10 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -stride            Use stride (proportional-share) scheduler.\n"
+          "  -cfs               Use virtual-runtime fair scheduler.\n"
+          "  -lockstat[=N]      Gather lock statistics; print top N at exit.\n"
+          "  -tickless          Stop the periodic timer tick while idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
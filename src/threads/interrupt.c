@@ -47,6 +47,17 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /**< Are we processing an external interrupt? */
 static bool yield_on_return;    /**< Should we yield on interrupt return? */
 
+/** Softirqs run on the way out of an external interrupt, after
+   the PIC has been acknowledged, with interrupts turned back on
+   so that the hard-IRQ part stays short.  They still may not
+   sleep.  An interrupt that arrives while softirqs are running
+   only raises its own; the outermost interrupt runs them all
+   before it returns, and only then yields. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+static unsigned softirq_pending;  /**< Bit N set if softirq N is raised. */
+static bool in_softirq;           /**< Are we running softirqs? */
+static void run_softirqs (void);
+
 /** Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -206,12 +217,12 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/** Returns true during processing of an external interrupt
-   and false at all other times. */
+/** Returns true during processing of an external interrupt or
+   its softirqs and false at all other times. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  return in_external_intr || in_softirq;
 }
 
 /** During processing of an external interrupt, directs the
@@ -224,6 +235,53 @@ intr_yield_on_return (void)
   ASSERT (intr_context ());
   yield_on_return = true;
 }
+
+/** Registers HANDLER to run whenever softirq N is raised. */
+void
+intr_register_softirq (enum softirq n, softirq_func *handler) 
+{
+  ASSERT (n < SOFTIRQ_CNT);
+  ASSERT (softirq_handlers[n] == NULL);
+  softirq_handlers[n] = handler;
+}
+
+/** Marks softirq N to run when the current external interrupt
+   returns, or at the end of the next one if called outside of an
+   interrupt. */
+void
+intr_raise_softirq (enum softirq n) 
+{
+  enum intr_level old_level;
+
+  ASSERT (n < SOFTIRQ_CNT);
+  old_level = intr_disable ();
+  softirq_pending |= 1u << n;
+  intr_set_level (old_level);
+}
+
+/** Runs raised softirqs until none remain.  Called with
+   interrupts off at the end of an external interrupt, and
+   returns the same way. */
+static void
+run_softirqs (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  in_softirq = true;
+  while (softirq_pending != 0) 
+    {
+      unsigned pending = softirq_pending;
+      int n;
+
+      softirq_pending = 0;
+      intr_enable ();
+      for (n = 0; n < SOFTIRQ_CNT; n++)
+        if ((pending & (1u << n)) && softirq_handlers[n] != NULL)
+          softirq_handlers[n] ();
+      intr_disable ();
+    }
+  in_softirq = false;
+}
 
 /** 8259A Programmable Interrupt Controller. */
 
@@ -355,10 +413,11 @@ intr_handler (struct intr_frame *frame)
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
+      ASSERT (!in_external_intr);
 
       in_external_intr = true;
-      yield_on_return = false;
+      if (!in_softirq)
+        yield_on_return = false;
     }
 
   /* Invoke the interrupt's handler. */
@@ -383,8 +442,12 @@ intr_handler (struct intr_frame *frame)
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no); 
 
+      if (in_softirq)
+        return;
+      if (softirq_pending != 0)
+        run_softirqs ();
       if (yield_on_return) 
-        thread_yield (); 
+        thread_preempt (); 
     }
 }
 
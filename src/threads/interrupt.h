@@ -57,12 +57,27 @@ struct intr_frame
 
 typedef void intr_handler_func (struct intr_frame *);
 
+/** Softirqs: the deferred halves of external interrupt handlers.
+   A hard handler raises one, and its function runs once the
+   interrupt has been acknowledged, still in interrupt context
+   but with interrupts turned on. */
+enum softirq
+  {
+    SOFTIRQ_TIMER,        /**< Timer wheel expiry (devices/timer.c). */
+    SOFTIRQ_RCU,          /**< RCU callbacks ready (threads/rcu.c). */
+    SOFTIRQ_CNT           /**< Number of softirqs. */
+  };
+
+typedef void softirq_func (void);
+
 void intr_init (void);
 void intr_register_ext (uint8_t vec, intr_handler_func *, const char *name);
 void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
+void intr_register_softirq (enum softirq, softirq_func *);
+void intr_raise_softirq (enum softirq);
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
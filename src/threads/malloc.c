@@ -32,15 +32,23 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   Each block is charged to a memory tag (see memtag.h), which the
+   arena header records in a byte per block, so that free() can
+   credit the same tag. */
 
 /** Descriptor. */
 struct desc
   {
     size_t block_size;          /**< Size of each element in bytes. */
     size_t blocks_per_arena;    /**< Number of blocks in an arena. */
+    size_t hdr_size;            /**< Offset of first block in an arena. */
+    size_t arena_cnt;           /**< Number of arenas. */
+    size_t free_cnt;            /**< Number of free blocks. */
     struct list free_list;      /**< List of free blocks. */
     struct lock lock;           /**< Lock. */
+    char name[16];              /**< Lock name, e.g. "malloc 16". */
   };
 
 /** Magic number for detecting arena corruption. */
@@ -52,6 +60,9 @@ struct arena
     unsigned magic;             /**< Always set to ARENA_MAGIC. */
     struct desc *desc;          /**< Owning descriptor, null for big block. */
     size_t free_cnt;            /**< Free blocks; pages in big block. */
+    uint8_t tags[1];            /**< Memory tag of each block.  Extends
+                                     past the end of the struct, except
+                                     for a big block. */
   };
 
 /** Free block. */
@@ -66,6 +77,7 @@ static size_t desc_cnt;         /**< Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static uint8_t *block_tag (struct block *);
 
 /** Initializes the malloc() descriptors. */
 void
@@ -78,9 +90,20 @@ malloc_init (void)
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
       d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+
+      /* Each block takes BLOCK_SIZE bytes plus a tag byte, and the
+         first block may need padding up to pointer alignment. */
+      d->blocks_per_arena = ((PGSIZE - offsetof (struct arena, tags)
+                              - (sizeof (void *) - 1))
+                             / (block_size + 1));
+      d->hdr_size = ROUND_UP (offsetof (struct arena, tags)
+                              + d->blocks_per_arena, sizeof (void *));
+      d->arena_cnt = 0;
+      d->free_cnt = 0;
       list_init (&d->free_list);
       lock_init (&d->lock);
+      snprintf (d->name, sizeof d->name, "malloc %zu", block_size);
+      lock_set_name (&d->lock, d->name);
     }
 }
 
@@ -88,6 +111,14 @@ malloc_init (void)
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return malloc_tagged (size, MEM_OTHER);
+}
+
+/** Obtains and returns a new block of at least SIZE bytes, charged
+   to TAG.  Returns a null pointer if memory is not available. */
+void *
+malloc_tagged (size_t size, enum mem_tag tag) 
 {
   struct desc *d;
   struct block *b;
@@ -107,7 +138,7 @@ malloc (size_t size)
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
-      a = palloc_get_multiple (0, page_cnt);
+      a = palloc_get_multiple (PAL_TAG (MEM_MALLOC), page_cnt);
       if (a == NULL)
         return NULL;
 
@@ -116,6 +147,8 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+      a->tags[0] = tag;
+      memtag_alloc (tag, PGSIZE * page_cnt - sizeof *a);
       return a + 1;
     }
 
@@ -127,7 +160,7 @@ malloc (size_t size)
       size_t i;
 
       /* Allocate a page. */
-      a = palloc_get_page (0);
+      a = palloc_get_page (PAL_TAG (MEM_MALLOC));
       if (a == NULL) 
         {
           lock_release (&d->lock);
@@ -143,16 +176,49 @@ malloc (size_t size)
           struct block *b = arena_to_block (a, i);
           list_push_back (&d->free_list, &b->free_elem);
         }
+      d->arena_cnt++;
+      d->free_cnt += d->blocks_per_arena;
     }
 
   /* Get a block from free list and return it. */
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  d->free_cnt--;
+  *block_tag (b) = tag;
   lock_release (&d->lock);
+  memtag_alloc (tag, d->block_size);
   return b;
 }
 
+/** Prints, for each descriptor, its arenas and how many of their
+   blocks are in use.  Fragmentation is the percentage of the
+   arenas' blocks that are free: since an arena with no blocks in
+   use is freed at once, that is memory held only because some
+   other block in its arena is in use. */
+void
+malloc_print_stats (void) 
+{
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++) 
+    {
+      size_t arena_cnt, free_cnt, block_cnt;
+
+      lock_acquire (&d->lock);
+      arena_cnt = d->arena_cnt;
+      free_cnt = d->free_cnt;
+      lock_release (&d->lock);
+
+      block_cnt = arena_cnt * d->blocks_per_arena;
+      if (arena_cnt > 0)
+        printf ("Malloc %zu: %zu arenas, %zu of %zu blocks in use, "
+                "%zu%% fragmented\n",
+                d->block_size, arena_cnt, block_cnt - free_cnt, block_cnt,
+                free_cnt * 100 / block_cnt);
+    }
+}
+
 /** Allocates and return A times B bytes initialized to zeroes.
    Returns a null pointer if memory is not available. */
 void *
@@ -201,7 +267,10 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = malloc_tagged (new_size,
+                                       (old_block != NULL
+                                        ? *block_tag (old_block)
+                                        : MEM_OTHER));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -223,7 +292,8 @@ free (void *p)
       struct block *b = p;
       struct arena *a = block_to_arena (b);
       struct desc *d = a->desc;
-      
+
+      memtag_free (*block_tag (b), block_size (b));
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
@@ -237,6 +307,7 @@ free (void *p)
 
           /* Add block to free list. */
           list_push_front (&d->free_list, &b->free_elem);
+          d->free_cnt++;
 
           /* If the arena is now entirely unused, free it. */
           if (++a->free_cnt >= d->blocks_per_arena) 
@@ -249,6 +320,8 @@ free (void *p)
                   struct block *b = arena_to_block (a, i);
                   list_remove (&b->free_elem);
                 }
+              d->arena_cnt--;
+              d->free_cnt -= d->blocks_per_arena;
               palloc_free_page (a);
             }
 
@@ -275,7 +348,7 @@ block_to_arena (struct block *b)
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+          || (pg_ofs (b) - a->desc->hdr_size) % a->desc->block_size == 0);
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
@@ -289,6 +362,17 @@ arena_to_block (struct arena *a, size_t idx)
   ASSERT (a->magic == ARENA_MAGIC);
   ASSERT (idx < a->desc->blocks_per_arena);
   return (struct block *) ((uint8_t *) a
-                           + sizeof *a
+                           + a->desc->hdr_size
                            + idx * a->desc->block_size);
 }
+
+/** Returns the location of block B's memory tag. */
+static uint8_t *
+block_tag (struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  if (a->desc == NULL)
+    return &a->tags[0];
+  return &a->tags[(pg_ofs (b) - a->desc->hdr_size) / a->desc->block_size];
+}
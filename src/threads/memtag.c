@@ -0,0 +1,93 @@
+#include "threads/memtag.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+/** Tag names, for statistics. */
+static const char *tag_names[MEM_TAG_CNT] = 
+  {
+    "other", "malloc", "slab", "thread", "fpu", "pagedir", "user",
+    "process", "inode", "file", "buffer", "device",
+  };
+
+/** Memory charged to each tag.  Updated with interrupts off, so
+   that allocators may charge memory whatever locks they hold. */
+static struct memtag_stats tags[MEM_TAG_CNT];
+
+/** Charges SIZE bytes, just allocated, to TAG. */
+void
+memtag_alloc (enum mem_tag tag, size_t size) 
+{
+  struct memtag_stats *s;
+  enum intr_level old_level;
+
+  ASSERT (tag < MEM_TAG_CNT);
+
+  s = &tags[tag];
+  old_level = intr_disable ();
+  s->live += size;
+  if (s->live > s->peak)
+    s->peak = s->live;
+  s->alloc_cnt++;
+  intr_set_level (old_level);
+}
+
+/** Credits SIZE bytes, just freed, to TAG. */
+void
+memtag_free (enum mem_tag tag, size_t size) 
+{
+  struct memtag_stats *s;
+  enum intr_level old_level;
+
+  ASSERT (tag < MEM_TAG_CNT);
+
+  s = &tags[tag];
+  old_level = intr_disable ();
+  ASSERT (s->live >= size);
+  s->live -= size;
+  s->free_cnt++;
+  intr_set_level (old_level);
+}
+
+/** Returns TAG's name. */
+const char *
+memtag_name (enum mem_tag tag) 
+{
+  ASSERT (tag < MEM_TAG_CNT);
+  return tag_names[tag];
+}
+
+/** Stores the memory charged to TAG in *STATS. */
+void
+memtag_get_stats (enum mem_tag tag, struct memtag_stats *stats) 
+{
+  enum intr_level old_level;
+
+  ASSERT (tag < MEM_TAG_CNT);
+
+  old_level = intr_disable ();
+  *stats = tags[tag];
+  intr_set_level (old_level);
+}
+
+/** Prints the memory charged to every tag that has seen any
+   allocations, followed by malloc()'s arena statistics.  May be
+   called at any time. */
+void
+memtag_print_stats (void) 
+{
+  enum mem_tag tag;
+
+  for (tag = 0; tag < MEM_TAG_CNT; tag++) 
+    {
+      struct memtag_stats s;
+
+      memtag_get_stats (tag, &s);
+      if (s.alloc_cnt > 0)
+        printf ("Memory %s: %zu bytes live, %zu peak, "
+                "%lu allocs, %lu frees\n",
+                tag_names[tag], s.live, s.peak, s.alloc_cnt, s.free_cnt);
+    }
+  malloc_print_stats ();
+}
@@ -0,0 +1,51 @@
+#ifndef THREADS_MEMTAG_H
+#define THREADS_MEMTAG_H
+
+#include <stddef.h>
+
+/** Memory accounting.
+
+   Every page from palloc, block from malloc, and object from a
+   slab cache is charged to a tag that says what it is for.  Each
+   tag counts the bytes it has live, its peak, and how many
+   allocations and frees it has seen.
+
+   Pages that hold malloc() arenas or slabs are charged to
+   MEM_MALLOC or MEM_SLAB, and the blocks and objects in them are
+   charged again, to their own tags, so the two kinds of tag
+   overlap. */
+
+/** What memory is for. */
+enum mem_tag
+  {
+    MEM_OTHER,                  /**< Untagged. */
+    MEM_MALLOC,                 /**< Pages holding malloc() arenas. */
+    MEM_SLAB,                   /**< Pages holding slabs. */
+    MEM_THREAD,                 /**< Threads and their kernel stacks. */
+    MEM_FPU,                    /**< FPU save areas. */
+    MEM_PAGEDIR,                /**< Page directories and tables. */
+    MEM_USER,                   /**< User pages. */
+    MEM_PROCESS,                /**< Process bookkeeping. */
+    MEM_INODE,                  /**< In-memory inodes. */
+    MEM_FILE,                   /**< Open files and directories. */
+    MEM_BUFFER,                 /**< I/O and bounce buffers. */
+    MEM_DEVICE,                 /**< Block devices and partitions. */
+    MEM_TAG_CNT                 /**< Number of tags. */
+  };
+
+/** Memory charged to a tag. */
+struct memtag_stats
+  {
+    size_t live;                /**< Bytes allocated now. */
+    size_t peak;                /**< Most bytes allocated at once. */
+    unsigned long alloc_cnt;    /**< Number of allocations. */
+    unsigned long free_cnt;     /**< Number of frees. */
+  };
+
+void memtag_alloc (enum mem_tag, size_t size);
+void memtag_free (enum mem_tag, size_t size);
+const char *memtag_name (enum mem_tag);
+void memtag_get_stats (enum mem_tag, struct memtag_stats *);
+void memtag_print_stats (void);
+
+#endif /**< threads/memtag.h */
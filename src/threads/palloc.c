@@ -1,5 +1,6 @@
 #include "threads/palloc.h"
 #include <bitmap.h>
+#include <list.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
@@ -7,8 +8,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/shrinker.h"
 #include "threads/vaddr.h"
 
 /** Page allocator.  Hands out memory in page-size (or
@@ -21,27 +23,114 @@
    that the kernel needs to have memory for its own operations
    even if user processes are swapping like mad.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   At boot, half of system RAM is given to the kernel pool and
+   half to the user pool, but the split is not fixed.  Memory is
+   divided into chunks of CHUNK_PAGES pages, and a pool that runs
+   out of free memory borrows a wholly free chunk from the other
+   pool, which lends only as long as it stays above its low
+   watermark; the kernel pool's low watermark is a reserve it
+   always keeps for itself.  A borrowed chunk goes back home when
+   it is wholly free again and its borrower has free pages above
+   its high watermark.
 
-/** A memory pool. */
+   Each pool is a binary buddy allocator, so allocating and
+   freeing take time logarithmic in the pool size rather than a
+   scan of the whole pool, and freed blocks coalesce with their
+   neighbors.
+
+   Each pool's free lists are protected by turning interrupts off,
+   not by a lock, so that freeing pages never sleeps.  The
+   scheduler frees a dying thread's stack page with interrupts
+   off, from thread_schedule_tail(), and the idle thread zeroes
+   pages ahead of time.  Buddy operations take time logarithmic in
+   the pool size, so interrupts stay off only briefly; clearing
+   and zeroing whole pages is done with them on. */
+
+/** Largest block the buddy allocator manages, as a power of 2
+   pages.  Larger requests fail. */
+#define MAX_ORDER PALLOC_MAX_ORDER
+
+/** Pages move between pools in chunks of 2**CHUNK_ORDER pages. */
+#define CHUNK_ORDER 6
+#define CHUNK_PAGES ((size_t) 1 << CHUNK_ORDER)
+
+/** The kernel pool keeps 1/KERNEL_RESERVE_DIV of the pages it
+   starts with rather than lend them to the user pool. */
+#define KERNEL_RESERVE_DIV 8
+
+/** The reclaimer thread is woken when fewer than
+   1/RECLAIM_LOW_DIV of all pages are free, and then reclaims until
+   twice that many are. */
+#define RECLAIM_LOW_DIV 32
+
+/** Marks, in the `heads' array, a page that does not start a free
+   block.  A page that starts a free block of order K holds
+   K + 1. */
+#define NOT_HEAD 0
+
+/** A memory pool, managed as a binary buddy system.
+
+   Every free block is 2**K pages long for some order K, starts at
+   a page index (relative to `base') that is a multiple of 2**K,
+   and sits on the free list for its order, linked through a
+   list_elem stored in its first page.  A free block's buddy is the
+   block of the same order whose index differs only in bit K; when
+   both are free, and belong to the same pool, they merge into one
+   block of order K + 1.  Blocks of CHUNK_PAGES pages or more are
+   made of whole chunks, all owned by the same pool. */
 struct pool
   {
-    struct lock lock;                   /**< Mutual exclusion. */
-    struct bitmap *used_map;            /**< Bitmap of free pages. */
-    uint8_t *base;                      /**< Base of pool. */
+    uint8_t id;                         /**< Index in `pools'. */
+    size_t page_cnt;                    /**< Number of pages owned. */
+    size_t free_cnt;                    /**< Number of free pages. */
+    size_t borrowed_cnt;                /**< Pages owned on loan. */
+    size_t page_limit;                  /**< Most pages to own. */
+    size_t low_water;                   /**< Lend only above this. */
+    size_t high_water;                  /**< Give back above this. */
+    uint32_t nonempty;                  /**< Bit K set if free[K] nonempty. */
+    struct list free[MAX_ORDER + 1];    /**< Free blocks by order. */
+
+    /* Pre-zeroed pages, protected by turning interrupts off. */
+    void *zeroed;                       /**< Stack of zeroed pages. */
+    size_t zeroed_cnt;                  /**< Number of zeroed pages. */
+    size_t zeroed_max;                  /**< Most zeroed pages to keep. */
+    unsigned long zero_hits;            /**< PAL_ZERO served pre-zeroed. */
+    unsigned long zero_misses;          /**< PAL_ZERO zeroed inline. */
   };
 
+/** Most pre-zeroed pages kept in a pool. */
+#define ZEROED_MAX 64
+
 /** Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
+static struct pool *const pools[] = {&kernel_pool, &user_pool};
+
+/** Memory shared by both pools. */
+static uint8_t *mem_base;               /**< First page. */
+static size_t mem_pages;                /**< Number of pages. */
+static uint8_t *heads;                  /**< Free block order + 1 per page. */
+static uint8_t *owners;                 /**< Owning pool's id per chunk. */
+static uint8_t *page_tags;              /**< Memory tag per page in use. */
+static size_t user_chunk;               /**< First chunk the user pool
+                                             starts out with. */
+static size_t reclaim_low;              /**< Reclaimer's low watermark. */
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+static void init_pool (struct pool *, uint8_t id, size_t page_idx,
+                       size_t page_cnt, const char *name);
+static struct pool *home_pool (size_t chunk);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static void tag_pages (void *pages, size_t page_cnt, enum mem_tag);
+static bool borrow_chunk (struct pool *);
+static void return_chunks (struct pool *, size_t page_idx,
+                           size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void *zeroed_pop (struct pool *, bool count);
+static size_t zeroed_drain (struct pool *);
 
 /** Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages are put into the user pool, which stops borrowing once it
+   owns that many. */
 void
 palloc_init (size_t user_page_limit)
 {
@@ -49,57 +138,125 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
+  size_t chunk_cnt = DIV_ROUND_UP (free_pages, CHUNK_PAGES);
+  size_t map_pages = DIV_ROUND_UP (2 * free_pages + chunk_cnt, PGSIZE);
+  size_t user_pages, kernel_pages;
+
+  /* We'll put the `heads', `page_tags' and `owners' arrays at the
+     start of free memory.  Calculate the space needed for them and subtract it
+     from the memory to manage. */
+  if (map_pages >= free_pages)
+    PANIC ("Not enough memory for buddy map.");
+  heads = free_start;
+  page_tags = free_start + free_pages;
+  owners = free_start + 2 * free_pages;
+  mem_base = free_start + map_pages * PGSIZE;
+  mem_pages = free_pages - map_pages;
+  memset (heads, NOT_HEAD, mem_pages);
+
+  /* Give half of memory to kernel, half to user, splitting at a
+     chunk boundary. */
+  user_pages = mem_pages / 2;
   if (user_pages > user_page_limit)
     user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  user_chunk = DIV_ROUND_UP (mem_pages - user_pages, CHUNK_PAGES);
+  kernel_pages = user_chunk * CHUNK_PAGES;
+  if (kernel_pages > mem_pages)
+    kernel_pages = mem_pages;
+  init_pool (&kernel_pool, 0, 0, kernel_pages, "kernel pool");
+  init_pool (&user_pool, 1, kernel_pages, mem_pages - kernel_pages,
+             "user pool");
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  kernel_pool.low_water = kernel_pages / KERNEL_RESERVE_DIV;
+  kernel_pool.high_water = kernel_pool.low_water + CHUNK_PAGES;
+  user_pool.page_limit = user_page_limit;
+  reclaim_low = mem_pages / RECLAIM_LOW_DIV;
 }
 
 /** Obtains and returns a group of PAGE_CNT contiguous free pages.
    If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
+   otherwise from the kernel pool.  A pool that runs short
+   borrows memory from the other one, and if there is still too
+   little, the shrinkers are asked to free some.  If PAL_ZERO is
+   set in FLAGS, then the pages are filled with zeros.  The pages
+   are charged to the memory tag given with PAL_TAG in FLAGS, or to
+   MEM_USER or MEM_OTHER if there is none.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
+  enum mem_tag tag = flags >> PAL_TAG_SHIFT;
+  void *pages = NULL;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
+  if (tag == MEM_OTHER && (flags & PAL_USER))
+    tag = MEM_USER;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  /* A single zeroed page comes from the pre-zeroed pages if there
+     are any. */
+  if (page_cnt == 1 && (flags & PAL_ZERO)) 
+    {
+      pages = zeroed_pop (pool, true);
+      if (pages != NULL) 
+        {
+          tag_pages (pages, 1, tag);
+          return pages;
+        }
+    }
 
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  page_idx = pool_alloc (pool, page_cnt);
 
-  if (pages != NULL) 
+  /* Pre-zeroed pages are free memory too.  If nothing else is
+     left, take one, or give them all back and try again. */
+  if (page_idx == BITMAP_ERROR) 
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+      if (page_cnt == 1)
+        pages = zeroed_pop (pool, false);
+      else if (zeroed_drain (pool) > 0)
+        page_idx = pool_alloc (pool, page_cnt);
     }
-  else 
+
+  /* Then have kernel caches give memory back, for as long as they
+     have any to give. */
+  while (page_idx == BITMAP_ERROR && pages == NULL
+         && shrink_memory (page_cnt) > 0)
+    page_idx = pool_alloc (pool, page_cnt);
+
+  if (page_idx != BITMAP_ERROR) 
     {
-      if (flags & PAL_ASSERT)
-        PANIC ("palloc_get: out of pages");
+      pages = mem_base + PGSIZE * page_idx;
+      if (flags & PAL_ZERO)
+        memset (pages, 0, PGSIZE * page_cnt);
     }
 
+  if (pages != NULL)
+    tag_pages (pages, page_cnt, tag);
+  if (palloc_below_watermark (false))
+    reclaim_wake ();
+
+  if (pages == NULL && (flags & PAL_ASSERT))
+    PANIC ("palloc_get: out of pages");
+
   return pages;
 }
 
+/** Returns true if free pages, in both pools together, are below
+   the reclaimer's high watermark if HIGH is true, or its low
+   watermark otherwise.  The answer is approximate, since
+   interrupts are not turned off. */
+bool
+palloc_below_watermark (bool high) 
+{
+  size_t free_cnt = (kernel_pool.free_cnt + kernel_pool.zeroed_cnt
+                     + user_pool.free_cnt + user_pool.zeroed_cnt);
+
+  return free_cnt < (high ? 2 * reclaim_low : reclaim_low);
+}
+
 /** Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -113,32 +270,96 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
-/** Frees the PAGE_CNT pages starting at PAGES. */
+/** Obtains PAGE_CNT contiguous free pages whose physical address
+   is a multiple of ALIGN pages, which must be a power of 2, and
+   returns the kernel virtual address of the first.  FLAGS are as
+   for palloc_get_multiple().
+
+   Unlike palloc_get_multiple(), this only takes what the pool
+   has free: it does not borrow from the other pool, drain the
+   pre-zeroed pages, or ask the shrinkers or the reclaimer for
+   memory.  It is meant for callers that can fall back to smaller
+   pages, such as load_segment(), so it fails cheaply instead.  If
+   the pool's memory starts at a physical address that is a
+   multiple of ALIGN pages, buddy blocks of ALIGN pages or more are
+   aligned already; otherwise, ALIGN - 1 extra pages are allocated
+   and the ones on either side of the aligned range freed, so the
+   request needs that much more contiguous memory to succeed. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt, size_t align)
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum mem_tag tag = flags >> PAL_TAG_SHIFT;
+  enum intr_level old_level;
+  size_t base_ofs, alloc_cnt, page_idx, head_cnt = 0;
+  uint8_t *pages;
+
+  ASSERT (align > 0 && (align & (align - 1)) == 0);
+
+  if (page_cnt == 0)
+    return NULL;
+  if (tag == MEM_OTHER && (flags & PAL_USER))
+    tag = MEM_USER;
+
+  base_ofs = pg_no ((void *) vtop (mem_base)) % align;
+  if (base_ofs == 0)
+    alloc_cnt = page_cnt > align ? page_cnt : align;
+  else
+    alloc_cnt = page_cnt + align - 1;
+
+  old_level = intr_disable ();
+  page_idx = buddy_alloc (pool, alloc_cnt);
+  if (page_idx != BITMAP_ERROR) 
+    {
+      head_cnt = (align - (base_ofs + page_idx) % align) % align;
+      buddy_free (pool, page_idx, head_cnt);
+      buddy_free (pool, page_idx + head_cnt + page_cnt,
+                  alloc_cnt - head_cnt - page_cnt);
+    }
+  intr_set_level (old_level);
+
+  if (page_idx == BITMAP_ERROR) 
+    {
+      if (flags & PAL_ASSERT)
+        PANIC ("palloc_get_aligned: out of pages");
+      return NULL;
+    }
+
+  pages = mem_base + PGSIZE * (page_idx + head_cnt);
+  if (flags & PAL_ZERO)
+    memset (pages, 0, PGSIZE * page_cnt);
+  tag_pages (pages, page_cnt, tag);
+  return pages;
+}
+
+/** Frees the PAGE_CNT pages starting at PAGES.  Never sleeps, so
+   it may be called with interrupts off. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  page_idx = pg_no (pages) - pg_no (mem_base);
+  ASSERT (page_idx + page_cnt <= mem_pages);
+  pool = pools[owners[page_idx >> CHUNK_ORDER]];
+  memtag_free (page_tags[page_idx], PGSIZE * page_cnt);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
+
+  if (pool->borrowed_cnt > 0)
+    return_chunks (pool, page_idx, page_cnt);
 }
 
 /** Frees the page at PAGE. */
@@ -148,35 +369,505 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/** Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/** Zeroes one free page ahead of time for a later PAL_ZERO request,
+   in whichever pool has the smaller share of its pre-zeroed pages.
+   Returns true if it zeroed a page, false if there is no need or no
+   free page to spare.  Called by the idle thread, so it never
+   sleeps. */
+bool
+palloc_zero_idle (void) 
+{
+  struct pool *pool;
+  enum intr_level old_level;
+  size_t page_idx;
+  void **page;
+
+  /* KC / KM < UC / UM, cross-multiplied. */
+  pool = (kernel_pool.zeroed_cnt * user_pool.zeroed_max
+          < user_pool.zeroed_cnt * kernel_pool.zeroed_max
+          ? &kernel_pool : &user_pool);
+  if (pool->zeroed_cnt >= pool->zeroed_max
+      || pool->free_cnt <= pool->zeroed_max)
+    return false;
+  old_level = intr_disable ();
+  page_idx = buddy_alloc (pool, 1);
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  page = (void **) (mem_base + PGSIZE * page_idx);
+  memset (page, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  *page = pool->zeroed;
+  pool->zeroed = page;
+  pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/** Fills in *STATS for the user pool if PAL_USER is set in FLAGS,
+   otherwise for the kernel pool. */
+void
+palloc_get_stats (enum palloc_flags flags, struct palloc_stats *stats) 
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+  int order;
+
+  old_level = intr_disable ();
+  stats->page_cnt = pool->page_cnt;
+  stats->free_cnt = pool->free_cnt;
+  stats->borrowed_cnt = pool->borrowed_cnt;
+  stats->largest_free = 0;
+  stats->zeroed_cnt = pool->zeroed_cnt;
+  stats->zero_hits = pool->zero_hits;
+  stats->zero_misses = pool->zero_misses;
+  for (order = 0; order <= MAX_ORDER; order++) 
+    {
+      stats->free_blocks[order] = list_size (&pool->free[order]);
+      if (stats->free_blocks[order] > 0)
+        stats->largest_free = (size_t) 1 << order;
+    }
+  intr_set_level (old_level);
+}
+
+/** Prints free memory and fragmentation for POOL, named NAME.
+   Fragmentation is the percentage of free pages that lie outside
+   the largest free block. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+print_pool_stats (enum palloc_flags flags, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  struct palloc_stats stats;
+  size_t blocks = 0;
+  int order;
+
+  palloc_get_stats (flags, &stats);
+  for (order = 0; order <= MAX_ORDER; order++)
+    blocks += stats.free_blocks[order];
+  printf ("%s: %zu of %zu pages free in %zu blocks, largest %zu, "
+          "%zu%% fragmented, %zu borrowed\n",
+          name, stats.free_cnt, stats.page_cnt, blocks, stats.largest_free,
+          stats.free_cnt > 0
+          ? (stats.free_cnt - stats.largest_free) * 100 / stats.free_cnt
+          : 0, stats.borrowed_cnt);
+  printf ("%s: %zu pre-zeroed pages, %lu zeroed-page hits, %lu misses\n",
+          name, stats.zeroed_cnt, stats.zero_hits, stats.zero_misses);
+}
+
+/** Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  print_pool_stats (0, "Kernel pool");
+  print_pool_stats (PAL_USER, "User pool");
+}
+
+/** Initializes pool P, with index ID in `pools', as owning the
+   PAGE_CNT pages starting at PAGE_IDX, naming it NAME for
+   debugging purposes.  PAGE_IDX must start a chunk. */
+static void
+init_pool (struct pool *p, uint8_t id, size_t page_idx, size_t page_cnt,
+           const char *name) 
+{
+  int order;
+
+  ASSERT (page_idx % CHUNK_PAGES == 0 || page_cnt == 0);
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->id = id;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->borrowed_cnt = 0;
+  p->page_limit = SIZE_MAX;
+  p->low_water = 0;
+  p->high_water = CHUNK_PAGES;
+  p->nonempty = 0;
+  p->zeroed = NULL;
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / 32 < ZEROED_MAX ? page_cnt / 32 : ZEROED_MAX;
+  p->zero_hits = p->zero_misses = 0;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free[order]);
+  memset (owners + page_idx / CHUNK_PAGES, id,
+          DIV_ROUND_UP (page_cnt, CHUNK_PAGES));
+
+  /* Hand the whole pool to the buddy system. */
+  buddy_free (p, page_idx, page_cnt);
+}
+
+/** Returns the pool that starts out owning CHUNK. */
+static struct pool *
+home_pool (size_t chunk) 
+{
+  return chunk < user_chunk ? &kernel_pool : &user_pool;
+}
+
+/** Takes a pre-zeroed page from POOL and returns it, or returns a
+   null pointer if there is none.  If COUNT is true, counts the
+   attempt as a hit or a miss. */
+static void *
+zeroed_pop (struct pool *pool, bool count) 
+{
+  enum intr_level old_level = intr_disable ();
+  void **page = pool->zeroed;
+
+  if (page != NULL) 
+    {
+      pool->zeroed = *page;
+      pool->zeroed_cnt--;
+    }
+  if (count) 
+    {
+      if (page != NULL)
+        pool->zero_hits++;
+      else
+        pool->zero_misses++;
+    }
+  intr_set_level (old_level);
+
+  /* The link was the only nonzero word. */
+  if (page != NULL)
+    *page = NULL;
+  return page;
 }
 
-/** Returns true if PAGE was allocated from POOL,
-   false otherwise. */
+/** Returns all of POOL's pre-zeroed pages to its free lists.
+   Returns the number of pages returned. */
+static size_t
+zeroed_drain (struct pool *pool) 
+{
+  enum intr_level old_level = intr_disable ();
+  void **page = pool->zeroed;
+  size_t cnt = pool->zeroed_cnt;
+
+  pool->zeroed = NULL;
+  pool->zeroed_cnt = 0;
+  while (page != NULL) 
+    {
+      void **next = *page;
+      buddy_free (pool, pg_no (page) - pg_no (mem_base), 1);
+      page = next;
+    }
+  intr_set_level (old_level);
+  return cnt;
+}
+
+/** Returns the free list element stored in page PAGE_IDX. */
+static struct list_elem *
+block_elem (size_t page_idx) 
+{
+  return (struct list_elem *) (mem_base + PGSIZE * page_idx);
+}
+
+/** Returns the index of the page whose free list element is E. */
+static size_t
+elem_idx (struct list_elem *e) 
+{
+  return ((uint8_t *) e - mem_base) / PGSIZE;
+}
+
+/** Adds the free block of order ORDER at PAGE_IDX to POOL's free
+   lists. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order) 
+{
+  heads[page_idx] = order + 1;
+  list_push_front (&pool->free[order], block_elem (page_idx));
+  pool->nonempty |= (uint32_t) 1 << order;
+}
+
+/** Removes the free block of order ORDER at PAGE_IDX from POOL's
+   free lists. */
+static void
+remove_block (struct pool *pool, size_t page_idx, int order) 
+{
+  heads[page_idx] = NOT_HEAD;
+  list_remove (block_elem (page_idx));
+  if (list_empty (&pool->free[order]))
+    pool->nonempty &= ~((uint32_t) 1 << order);
+}
+
+/** Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+order_for (size_t page_cnt) 
+{
+  int order = 0;
+
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/** Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  Takes the smallest free block that fits, splitting it
+   down to the size needed, and gives back the tail pages beyond
+   PAGE_CNT so that odd-sized requests waste nothing.  Interrupts
+   must be off. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) 
+{
+  int order = order_for (page_cnt);
+  uint32_t candidates;
+  size_t page_idx, block_cnt;
+  int avail;
+
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+  candidates = pool->nonempty & ~(((uint32_t) 1 << order) - 1);
+  if (candidates == 0)
+    return BITMAP_ERROR;
+
+  /* The lowest nonempty order at least as large as ORDER. */
+  avail = __builtin_ctz (candidates);
+  page_idx = elem_idx (list_front (&pool->free[avail]));
+  remove_block (pool, page_idx, avail);
+
+  /* Split off upper halves until the block has ORDER. */
+  while (avail > order) 
+    {
+      avail--;
+      push_block (pool, page_idx + ((size_t) 1 << avail), avail);
+    }
+
+  block_cnt = (size_t) 1 << order;
+  pool->free_cnt -= block_cnt;
+  if (page_cnt < block_cnt)
+    buddy_free (pool, page_idx + page_cnt, block_cnt - page_cnt);
+  return page_idx;
+}
+
+/** Returns PAGE_CNT pages starting at PAGE_IDX to POOL.  The range
+   is split into the largest aligned blocks it contains, and each
+   merges with its buddy for as long as that buddy is free.
+   Interrupts must be off. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  ASSERT (page_idx + page_cnt <= mem_pages);
+
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0) 
+    {
+      size_t idx = page_idx;
+      int order = 0;
+
+      /* Largest aligned block at PAGE_IDX that fits in the range. */
+      while (order < MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+
+      ASSERT (heads[idx] == NOT_HEAD);
+
+      /* Merge with free buddies. */
+      while (order < MAX_ORDER) 
+        {
+          size_t buddy = idx ^ ((size_t) 1 << order);
+
+          if (buddy + ((size_t) 1 << order) > mem_pages)
+            break;
+
+          /* A buddy in another chunk may belong to the other pool. */
+          if (order >= CHUNK_ORDER
+              && owners[buddy >> CHUNK_ORDER] != pool->id)
+            break;
+          if (heads[buddy] != order + 1)
+            break;
+          remove_block (pool, buddy, order);
+          if (buddy < idx)
+            idx = buddy;
+          order++;
+        }
+      push_block (pool, idx, order);
+    }
+}
+
+/** Returns the index of the free block that wholly contains
+   CHUNK, storing its order in *ORDER, or BITMAP_ERROR if some of
+   CHUNK is in use.  Interrupts must be off. */
+static size_t
+chunk_block (size_t chunk, int *order) 
+{
+  size_t page_idx = chunk << CHUNK_ORDER;
+  int o;
+
+  for (o = CHUNK_ORDER; o <= MAX_ORDER; o++) 
+    {
+      size_t block = page_idx & ~(((size_t) 1 << o) - 1);
+
+      if (heads[block] == o + 1) 
+        {
+          *order = o;
+          return block;
+        }
+    }
+  return BITMAP_ERROR;
+}
+
+/** Takes CHUNK, which lies in FROM's free block of order ORDER at
+   BLOCK, off FROM's free lists and makes TO its owner.  The rest of
+   the block stays free in FROM.  The caller must then pass CHUNK
+   to attach_chunk().  Interrupts must be off. */
+static void
+detach_chunk (struct pool *from, size_t block, int order, size_t chunk,
+              struct pool *to) 
+{
+  size_t page_idx = chunk << CHUNK_ORDER;
+
+  /* Split off the halves that do not hold CHUNK. */
+  remove_block (from, block, order);
+  while (order > CHUNK_ORDER) 
+    {
+      size_t half = (size_t) 1 << --order;
+
+      if (page_idx & half) 
+        {
+          push_block (from, block, order);
+          block += half;
+        }
+      else
+        push_block (from, block + half, order);
+    }
+  ASSERT (block == page_idx);
+
+  from->page_cnt -= CHUNK_PAGES;
+  from->free_cnt -= CHUNK_PAGES;
+  if (home_pool (chunk) != from)
+    from->borrowed_cnt -= CHUNK_PAGES;
+  owners[chunk] = to->id;
+}
+
+/** Adds CHUNK, just detached from another pool, to POOL's free
+   pages.  Interrupts must be off. */
+static void
+attach_chunk (struct pool *pool, size_t chunk) 
+{
+  pool->page_cnt += CHUNK_PAGES;
+  if (home_pool (chunk) != pool)
+    pool->borrowed_cnt += CHUNK_PAGES;
+  buddy_free (pool, chunk << CHUNK_ORDER, CHUNK_PAGES);
+}
+
+/** Allocates PAGE_CNT contiguous pages from POOL, borrowing from
+   the other pool, a chunk at a time, up to as many chunks as the
+   request would fill.  Returns the index of the first page, or
+   BITMAP_ERROR if the pages are not available. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt) 
+{
+  size_t borrow_cnt = DIV_ROUND_UP (page_cnt, CHUNK_PAGES);
+  size_t page_idx;
+
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      page_idx = buddy_alloc (pool, page_cnt);
+      intr_set_level (old_level);
+
+      if (page_idx != BITMAP_ERROR || borrow_cnt-- == 0
+          || !borrow_chunk (pool))
+        return page_idx;
+    }
+}
+
+/** Charges the PAGE_CNT pages at PAGES, just allocated, to TAG. */
+static void
+tag_pages (void *pages, size_t page_cnt, enum mem_tag tag) 
+{
+  memset (page_tags + (pg_no (pages) - pg_no (mem_base)), tag, page_cnt);
+  memtag_alloc (tag, PGSIZE * page_cnt);
+}
+
+/** Moves a wholly free chunk from the other pool into POOL, if the
+   other pool has one to spare above its low watermark and POOL
+   owns fewer pages than its limit.  The kernel pool lends its highest chunk and the user
+   pool its lowest, so that a pool's chunks stay together near its
+   home and chunks on loan are the first to go back.  Returns true
+   if successful, false otherwise. */
 static bool
-page_from_pool (const struct pool *pool, void *page) 
+borrow_chunk (struct pool *pool) 
 {
-  size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  struct pool *lender = pool == &kernel_pool ? &user_pool : &kernel_pool;
+  bool lend_high = lender == &kernel_pool;
+  size_t best_block = BITMAP_ERROR;
+  size_t best_chunk = 0;
+  int best_order = 0;
+  enum intr_level old_level;
+  int order;
+
+  if (pool->page_cnt >= pool->page_limit)
+    return false;
 
-  return page_no >= start_page && page_no < end_page;
+  old_level = intr_disable ();
+  if (lender->free_cnt >= lender->low_water + CHUNK_PAGES)
+    for (order = CHUNK_ORDER; order <= MAX_ORDER; order++) 
+      {
+        struct list *list = &lender->free[order];
+        struct list_elem *e;
+
+        for (e = list_begin (list); e != list_end (list); e = list_next (e)) 
+          {
+            size_t block = elem_idx (e);
+            size_t chunk = (lend_high
+                            ? block + ((size_t) 1 << order) - CHUNK_PAGES
+                            : block) >> CHUNK_ORDER;
+
+            if (best_block == BITMAP_ERROR
+                || (lend_high ? chunk > best_chunk : chunk < best_chunk)) 
+              {
+                best_block = block;
+                best_order = order;
+                best_chunk = chunk;
+              }
+          }
+      }
+  if (best_block != BITMAP_ERROR) 
+    {
+      detach_chunk (lender, best_block, best_order, best_chunk, pool);
+      attach_chunk (pool, best_chunk);
+    }
+  intr_set_level (old_level);
+
+  return best_block != BITMAP_ERROR;
+}
+
+/** Gives back to their home pools those chunks among the ones
+   overlapping the PAGE_CNT pages at PAGE_IDX, just freed into POOL,
+   that POOL has on loan and that are wholly free again, as long as
+   POOL's free pages stay above its high watermark. */
+static void
+return_chunks (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  size_t chunk = page_idx >> CHUNK_ORDER;
+  size_t last = (page_idx + page_cnt - 1) >> CHUNK_ORDER;
+
+  for (; chunk <= last; chunk++) 
+    {
+      struct pool *home = home_pool (chunk);
+      enum intr_level old_level;
+      size_t block;
+      int order;
+
+      if (home == pool)
+        continue;
+
+      old_level = intr_disable ();
+      if (owners[chunk] == pool->id
+          && pool->free_cnt >= pool->high_water + CHUNK_PAGES) 
+        {
+          block = chunk_block (chunk, &order);
+          if (block != BITMAP_ERROR) 
+            {
+              detach_chunk (pool, block, order, chunk, home);
+              attach_chunk (home, chunk);
+            }
+        }
+      intr_set_level (old_level);
+    }
 }
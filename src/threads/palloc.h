@@ -1,7 +1,9 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include "threads/memtag.h"
 
 /** How to allocate pages. */
 enum palloc_flags
@@ -11,10 +13,35 @@ enum palloc_flags
     PAL_USER = 004              /**< User page. */
   };
 
+/** Palloc flag that charges the pages to memory tag TAG. */
+#define PAL_TAG_SHIFT 8
+#define PAL_TAG(TAG) ((TAG) << PAL_TAG_SHIFT)
+
+/** Largest block a pool manages, as a power of 2 pages. */
+#define PALLOC_MAX_ORDER 16
+
+/** Free memory in a pool. */
+struct palloc_stats
+  {
+    size_t page_cnt;            /**< Pages the pool owns now. */
+    size_t free_cnt;            /**< Free pages. */
+    size_t borrowed_cnt;        /**< Owned pages on loan from the other. */
+    size_t largest_free;        /**< Pages in the largest free block. */
+    size_t free_blocks[PALLOC_MAX_ORDER + 1]; /**< Free blocks by order. */
+    size_t zeroed_cnt;          /**< Pre-zeroed pages, not counted free. */
+    unsigned long zero_hits;    /**< PAL_ZERO pages served pre-zeroed. */
+    unsigned long zero_misses;  /**< PAL_ZERO pages zeroed on demand. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
+void *palloc_get_aligned (enum palloc_flags, size_t page_cnt, size_t align);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_idle (void);
+bool palloc_below_watermark (bool high);
+void palloc_get_stats (enum palloc_flags, struct palloc_stats *);
+void palloc_print_stats (void);
 
 #endif /**< threads/palloc.h */
@@ -0,0 +1,225 @@
+#include "threads/rcu.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+
+/** Callbacks queued since the current grace period started, which
+   must wait for the next one. */
+static struct list next_list;
+
+/** Callbacks waiting for the current grace period to end. */
+static struct list wait_list;
+
+/** Callbacks whose grace period has ended, to be run by
+   done_work. */
+static struct list done_list;
+static struct work done_work;
+
+/** CPUs that take part in grace periods, and those that have yet
+   to pass through a quiescent state in the current one, one bit
+   per CPU.  No grace period is in progress while `pending' is
+   0. */
+static uint32_t online_cpus;
+static uint32_t pending_cpus;
+
+static void run_callbacks (void *aux);
+static void rcu_softirq (void);
+
+/** Initializes RCU, with the bootstrap processor as the only CPU
+   taking part in grace periods.  Must be called before the first
+   context switch or timer tick.  call_rcu() callbacks run only
+   once workqueue_start() has started the worker. */
+void
+rcu_init (void) 
+{
+  list_init (&next_list);
+  list_init (&wait_list);
+  list_init (&done_list);
+  work_init (&done_work, run_callbacks, NULL);
+  online_cpus = 1;
+  pending_cpus = 0;
+  intr_register_softirq (SOFTIRQ_RCU, rcu_softirq);
+}
+
+/** Enters a read-side critical section, which may nest.  Until the
+   matching rcu_read_unlock(), the running thread is not
+   preempted and must not sleep, and whatever it finds in an
+   RCU-protected structure stays valid. */
+void
+rcu_read_lock (void) 
+{
+  thread_current ()->rcu_nesting++;
+  barrier ();
+}
+
+/** Leaves a read-side critical section.  Leaving the outermost one
+   yields the CPU if an interrupt asked to preempt the thread in
+   the meantime. */
+void
+rcu_read_unlock (void) 
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->rcu_nesting > 0);
+
+  barrier ();
+  if (--cur->rcu_nesting == 0 && cur->rcu_preempted) 
+    {
+      cur->rcu_preempted = false;
+      thread_yield ();
+    }
+}
+
+/** Returns true if the running thread is inside a read-side
+   critical section, and so must not sleep. */
+bool
+rcu_read_lock_held (void) 
+{
+  return !intr_context () && thread_current ()->rcu_nesting > 0;
+}
+
+/** Notes that CPU has passed through a quiescent state: it is not
+   in a read-side critical section, and every one it was in
+   before has ended.  Starts a grace period if callbacks are
+   waiting for one, and when the last CPU reports in, raises a
+   softirq to hand the callbacks of the one that ended to the
+   worker thread.  Queuing the work directly could wake the
+   worker from within the scheduler.  Interrupts must be off. */
+void
+rcu_quiescent_state (unsigned cpu) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (cpu < 32);
+
+  if (pending_cpus == 0) 
+    {
+      if (list_empty (&next_list))
+        return;
+      list_splice (list_end (&wait_list),
+                   list_begin (&next_list), list_end (&next_list));
+      pending_cpus = online_cpus;
+    }
+
+  pending_cpus &= ~((uint32_t) 1 << cpu);
+  if (pending_cpus == 0) 
+    {
+      list_splice (list_end (&done_list),
+                   list_begin (&wait_list), list_end (&wait_list));
+      intr_raise_softirq (SOFTIRQ_RCU);
+    }
+}
+
+/** Returns true if callbacks are waiting for a grace period or
+   for the softirq that hands them to the worker, so that the
+   timer must keep ticking. */
+bool
+rcu_pending (void) 
+{
+  return (pending_cpus != 0 || !list_empty (&next_list)
+          || !list_empty (&done_list));
+}
+
+/** Arranges for FUNC(HEAD) to be called, in a kernel thread, once
+   every read-side critical section in progress has ended.
+
+   This function may be called from an interrupt handler. */
+void
+call_rcu (struct rcu_head *head, rcu_func *func) 
+{
+  enum intr_level old_level;
+
+  ASSERT (head != NULL);
+  ASSERT (func != NULL);
+
+  head->func = func;
+  old_level = intr_disable ();
+  list_push_back (&next_list, &head->elem);
+  intr_set_level (old_level);
+}
+
+/** A grace period that a thread is waiting for. */
+struct rcu_sync 
+  {
+    struct rcu_head head;
+    struct semaphore done;
+  };
+
+static void
+sync_done (struct rcu_head *head) 
+{
+  struct rcu_sync *sync = list_entry (&head->elem, struct rcu_sync,
+                                      head.elem);
+  sema_up (&sync->done);
+}
+
+/** Waits until every read-side critical section in progress has
+   ended.  Must not be called from within one. */
+void
+synchronize_rcu (void) 
+{
+  struct rcu_sync sync;
+
+  ASSERT (!intr_context ());
+
+  sema_init (&sync.done, 0);
+  call_rcu (&sync.head, sync_done);
+  sema_down (&sync.done);
+}
+
+/** Inserts ELEM just before BEFORE, which may be an interior
+   element or a tail, so that concurrent readers see ELEM either
+   not at all or fully linked.  Writers must be serialized. */
+void
+rcu_list_insert (struct list_elem *before, struct list_elem *elem) 
+{
+  ASSERT (before != NULL && elem != NULL);
+
+  elem->prev = before->prev;
+  elem->next = before;
+  barrier ();
+  before->prev->next = elem;
+  before->prev = elem;
+}
+
+/** Removes ELEM from its list.  ELEM's own links are left alone, so
+   that a concurrent reader standing on ELEM can still step past
+   it; ELEM may be reused only after a grace period.  Writers
+   must be serialized. */
+void
+rcu_list_remove (struct list_elem *elem) 
+{
+  list_remove (elem);
+}
+
+/** Softirq handler: queues the callbacks whose grace period has
+   ended to run in the worker thread. */
+static void
+rcu_softirq (void) 
+{
+  work_schedule (&done_work);
+}
+
+/** Runs the callbacks whose grace period has ended. */
+static void
+run_callbacks (void *aux UNUSED) 
+{
+  struct list batch;
+  enum intr_level old_level;
+
+  list_init (&batch);
+  old_level = intr_disable ();
+  if (!list_empty (&done_list))
+    list_splice (list_end (&batch),
+                 list_begin (&done_list), list_end (&done_list));
+  intr_set_level (old_level);
+
+  while (!list_empty (&batch)) 
+    {
+      struct rcu_head *head = list_entry (list_pop_front (&batch),
+                                          struct rcu_head, elem);
+      head->func (head);
+    }
+}
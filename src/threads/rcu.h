@@ -0,0 +1,55 @@
+#ifndef THREADS_RCU_H
+#define THREADS_RCU_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/** Read-copy update.
+
+   RCU lets readers walk a read-mostly linked structure without
+   disabling interrupts or taking a lock, concurrently with
+   writers that change it.  A reader brackets its walk with
+   rcu_read_lock() and rcu_read_unlock(), and must not sleep in
+   between.  Instead of turning off interrupts, a read-side
+   critical section only holds off preemption: an interrupt that
+   would switch threads defers the switch until the reader
+   leaves.
+
+   Writers serialize among themselves, usually with a lock, and
+   publish changes in an order that keeps the structure
+   consistent for readers at every step; rcu_list_insert() and
+   rcu_list_remove() do this for lists.  Memory unlinked by a
+   writer may still be in use by readers that found it earlier,
+   so it is freed only after a grace period, once every CPU has
+   passed through a quiescent state.  Because readers are not
+   preempted, a context switch, or a timer tick that interrupts
+   a thread outside any read-side critical section, is a
+   quiescent state.  call_rcu() runs a callback after a grace
+   period, and synchronize_rcu() waits for one. */
+
+struct rcu_head;
+
+/** Callback run by call_rcu() after a grace period. */
+typedef void rcu_func (struct rcu_head *);
+
+/** Deferred callback, usually embedded in the structure that it
+   frees. */
+struct rcu_head 
+  {
+    struct list_elem elem;      /**< Element in a callback list. */
+    rcu_func *func;             /**< Function to call. */
+  };
+
+void rcu_init (void);
+void rcu_read_lock (void);
+void rcu_read_unlock (void);
+bool rcu_read_lock_held (void);
+void rcu_quiescent_state (unsigned cpu);
+bool rcu_pending (void);
+void call_rcu (struct rcu_head *, rcu_func *);
+void synchronize_rcu (void);
+
+void rcu_list_insert (struct list_elem *before, struct list_elem *);
+void rcu_list_remove (struct list_elem *);
+
+#endif /**< threads/rcu.h */
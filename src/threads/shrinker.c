@@ -0,0 +1,154 @@
+#include "threads/shrinker.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/** Objects the reclaimer asks the shrinkers for at a time. */
+#define RECLAIM_BATCH 16
+
+/** All shrinkers.  Shrinkers are only ever added, with interrupts
+   off. */
+static struct list shrinkers = LIST_INITIALIZER (shrinkers);
+
+/** Reclaimer thread state, protected by turning interrupts off. */
+static struct semaphore reclaim_sema;   /**< Upped to wake reclaimer. */
+static bool reclaim_running;            /**< Reclaimer started? */
+static bool reclaim_pending;            /**< Wakeup not yet taken? */
+static unsigned long reclaim_runs;      /**< Times woken. */
+
+static thread_func reclaimer;
+
+/** Initializes S as a shrinker named NAME, with callbacks COUNT and
+   SCAN, which are passed AUX, and adds it to the list of
+   shrinkers.  S must stay registered for as long as the kernel
+   runs. */
+void
+shrinker_register (struct shrinker *s, const char *name,
+                   shrinker_count_func *count, shrinker_scan_func *scan,
+                   void *aux) 
+{
+  enum intr_level old_level;
+
+  ASSERT (s != NULL);
+  ASSERT (count != NULL);
+  ASSERT (scan != NULL);
+
+  s->name = name;
+  s->count = count;
+  s->scan = scan;
+  s->aux = aux;
+  s->freed = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&shrinkers, &s->elem);
+  intr_set_level (old_level);
+}
+
+/** Asks the shrinkers to free NR objects in all, sharing the work
+   out in proportion to the number of objects each could free, and
+   at least one from each that could free any.  Returns the number
+   of objects freed, which may be more or less than NR. */
+size_t
+shrink_memory (size_t nr) 
+{
+  struct list_elem *e;
+  size_t total = 0;
+  size_t freed = 0;
+
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e)) 
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      total += s->count (s->aux);
+    }
+  if (total == 0)
+    return 0;
+
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e)) 
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      size_t cnt = s->count (s->aux);
+      size_t share = nr < total ? nr * cnt / total : cnt;
+      size_t done;
+
+      if (cnt == 0)
+        continue;
+      if (share == 0)
+        share = 1;
+      done = s->scan (share, s->aux);
+      s->freed += done;
+      freed += done;
+    }
+  return freed;
+}
+
+/** Starts the reclaimer thread.  Must be called after
+   thread_start(). */
+void
+reclaim_init (void) 
+{
+  sema_init (&reclaim_sema, 0);
+  thread_create ("kreclaimd", PRI_DEFAULT, reclaimer, NULL);
+}
+
+/** Wakes the reclaimer thread, if it is running and not already
+   awake. */
+void
+reclaim_wake (void) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (reclaim_running && !reclaim_pending) 
+    {
+      reclaim_pending = true;
+      sema_up (&reclaim_sema);
+    }
+  intr_set_level (old_level);
+}
+
+/** Prints statistics for every shrinker. */
+void
+shrinker_print_stats (void) 
+{
+  struct list_elem *e;
+
+  printf ("Reclaim: woken %lu times\n", reclaim_runs);
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e)) 
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      printf ("Shrinker %s: %lu objects freed, %zu reclaimable\n",
+              s->name, s->freed, s->count (s->aux));
+    }
+}
+
+/** Reclaimer thread.  Each time it is woken, runs the shrinkers a
+   batch at a time until the page allocator is above its high
+   watermark or nothing more can be freed. */
+static void
+reclaimer (void *aux UNUSED) 
+{
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  reclaim_running = true;
+  intr_set_level (old_level);
+
+  for (;;) 
+    {
+      sema_down (&reclaim_sema);
+
+      old_level = intr_disable ();
+      reclaim_pending = false;
+      reclaim_runs++;
+      intr_set_level (old_level);
+
+      while (palloc_below_watermark (true)
+             && shrink_memory (RECLAIM_BATCH) > 0)
+        continue;
+    }
+}
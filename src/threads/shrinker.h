@@ -0,0 +1,51 @@
+#ifndef THREADS_SHRINKER_H
+#define THREADS_SHRINKER_H
+
+#include <list.h>
+#include <stddef.h>
+
+/** Memory shrinkers.
+
+   A kernel cache that holds memory it could do without registers a
+   shrinker, so that it can use memory freely and still give it
+   back when memory runs short.  A shrinker has two callbacks: one
+   reports how many objects the cache could free, and the other
+   frees up to a given number of them.  What an "object" is, is up
+   to the cache, but it should be of the order of a page.
+
+   The page allocator runs the shrinkers before it fails an
+   allocation, and the reclaimer thread runs them in the background
+   whenever free memory drops below a low watermark, until it is
+   back above a high one.  Shrinkers are therefore called from
+   whatever thread is allocating memory, possibly holding locks of
+   its own, so they must not allocate memory themselves or wait
+   on a lock that may be held across a call to the allocator. */
+
+/** Returns the number of objects a shrinker's cache could free.
+   Need not be exact. */
+typedef size_t shrinker_count_func (void *aux);
+
+/** Frees up to NR objects from a shrinker's cache and returns the
+   number freed. */
+typedef size_t shrinker_scan_func (size_t nr, void *aux);
+
+/** A shrinker. */
+struct shrinker
+  {
+    const char *name;           /**< Name, for statistics. */
+    shrinker_count_func *count; /**< Counts reclaimable objects. */
+    shrinker_scan_func *scan;   /**< Frees objects. */
+    void *aux;                  /**< Argument to `count' and `scan'. */
+    unsigned long freed;        /**< Objects freed so far. */
+    struct list_elem elem;      /**< Element in list of shrinkers. */
+  };
+
+void shrinker_register (struct shrinker *, const char *name,
+                        shrinker_count_func *, shrinker_scan_func *,
+                        void *aux);
+size_t shrink_memory (size_t nr);
+void reclaim_init (void);
+void reclaim_wake (void);
+void shrinker_print_stats (void);
+
+#endif /**< threads/shrinker.h */
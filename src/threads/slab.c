@@ -0,0 +1,314 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/vaddr.h"
+
+/** Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/** Empty slabs a cache keeps for reuse before it gives them back
+   to the page allocator.  More than one, so that a cache whose
+   usage swings back and forth across a few slab boundaries reuses
+   the same slabs instead of freeing and reallocating a page each
+   time; the shrinker takes the rest back under memory pressure. */
+#define EMPTY_SLAB_MAX 4
+
+/** Objects are aligned to this many bytes. */
+#define OBJ_ALIGN 8
+
+/** Slab header, at the start of each slab's page.  Objects follow
+   it. */
+struct slab
+  {
+    unsigned magic;             /**< Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /**< Owning cache. */
+    struct list_elem elem;      /**< Element in a cache's slab list. */
+    size_t free_cnt;            /**< Number of free objects. */
+    void *free;                 /**< First free object. */
+  };
+
+/** Offset of the first object in a slab. */
+#define SLAB_HDR_SIZE ROUND_UP (sizeof (struct slab), OBJ_ALIGN)
+
+/** All caches, so that kmem_reap() and the shrinker can find
+   them.  Caches are only ever added, with interrupts off. */
+static struct list caches = LIST_INITIALIZER (caches);
+
+/** Gives empty slabs back under memory pressure.  Registered along
+   with the first cache. */
+static struct shrinker slab_shrinker;
+static shrinker_count_func slab_count;
+static shrinker_scan_func slab_scan;
+
+/** Returns the location of the free list link for OBJ in C.  The
+   link overlays the object itself unless C has a constructor,
+   whose work it would destroy; then it follows the object. */
+static void **
+free_link (const struct kmem_cache *c, void *obj) 
+{
+  return (void **) ((uint8_t *) obj + (c->ctor != NULL ? c->obj_size : 0));
+}
+
+/** Returns the slab that OBJ belongs to. */
+static struct slab *
+obj_to_slab (void *obj) 
+{
+  struct slab *s = pg_round_down (obj);
+
+  ASSERT (s->magic == SLAB_MAGIC);
+  return s;
+}
+
+/** Initializes cache C for objects of SIZE bytes, named NAME, and
+   charged to memory tag TAG.  If CTOR is nonnull, it is called on
+   each object when its slab is created.  SIZE must leave room for
+   at least one object in a page. */
+void
+kmem_cache_init (struct kmem_cache *c, const char *name, size_t size,
+                 kmem_ctor *ctor, enum mem_tag tag) 
+{
+  enum intr_level old_level;
+
+  ASSERT (c != NULL);
+  ASSERT (size > 0);
+
+  strlcpy (c->name, name, sizeof c->name);
+  c->obj_size = size;
+  c->ctor = ctor;
+  c->tag = tag;
+  c->stride = ROUND_UP (size + (ctor != NULL ? sizeof (void *) : 0),
+                        OBJ_ALIGN);
+  if (c->stride < sizeof (void *))
+    c->stride = sizeof (void *);
+  ASSERT (c->stride <= PGSIZE - SLAB_HDR_SIZE);
+  c->objs_per_slab = (PGSIZE - SLAB_HDR_SIZE) / c->stride;
+
+  lock_init (&c->lock);
+  lock_set_name (&c->lock, c->name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+  c->slab_cnt = 0;
+  c->active_cnt = 0;
+
+  old_level = intr_disable ();
+  if (list_empty (&caches))
+    shrinker_register (&slab_shrinker, "slab", slab_count, slab_scan, NULL);
+  list_push_back (&caches, &c->elem);
+  intr_set_level (old_level);
+}
+
+/** Carves a new slab for C out of a fresh page and runs C's
+   constructor on its objects.  Returns the slab, or a null
+   pointer if no page is available even after the shrinkers have
+   run, which reaps empty slabs from every cache. */
+static struct slab *
+slab_create (struct kmem_cache *c) 
+{
+  struct slab *s = palloc_get_page (PAL_TAG (MEM_SLAB));
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free = NULL;
+  for (i = c->objs_per_slab; i-- > 0; ) 
+    {
+      void *obj = (uint8_t *) s + SLAB_HDR_SIZE + i * c->stride;
+      if (c->ctor != NULL)
+        c->ctor (obj);
+      *free_link (c, obj) = s->free;
+      s->free = obj;
+    }
+  return s;
+}
+
+/** Allocates and returns an object from cache C, or a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (list_empty (&c->partial)) 
+    {
+      if (!list_empty (&c->empty)) 
+        {
+          s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+          c->empty_cnt--;
+        }
+      else 
+        {
+          /* Allocate the page without the lock, since it may have
+             to reap this cache. */
+          lock_release (&c->lock);
+          s = slab_create (c);
+          if (s == NULL)
+            return NULL;
+          lock_acquire (&c->lock);
+          c->slab_cnt++;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *free_link (c, obj);
+  if (--s->free_cnt == 0) 
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  c->active_cnt++;
+  lock_release (&c->lock);
+
+  memtag_alloc (c->tag, c->obj_size);
+  return obj;
+}
+
+/** Returns OBJ, which must have been allocated from cache C, to
+   C.  Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s;
+  void *release = NULL;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (obj);
+  ASSERT (s->cache == c);
+  memtag_free (c->tag, c->obj_size);
+  ASSERT (((uint8_t *) obj - (uint8_t *) s - SLAB_HDR_SIZE) % c->stride == 0);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  *free_link (c, obj) = s->free;
+  s->free = obj;
+  c->active_cnt--;
+
+  if (s->free_cnt++ == 0) 
+    {
+      /* Was full, now partial. */
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->free_cnt == c->objs_per_slab) 
+    {
+      /* Now empty.  Keep it for reuse, unless we have enough. */
+      list_remove (&s->elem);
+      if (c->empty_cnt < EMPTY_SLAB_MAX) 
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else 
+        {
+          c->slab_cnt--;
+          release = s;
+        }
+    }
+  lock_release (&c->lock);
+
+  palloc_free_page (release);
+}
+
+/** Gives every empty slab in cache C back to the page allocator.
+   Returns the number of pages freed. */
+size_t
+kmem_cache_shrink (struct kmem_cache *c) 
+{
+  struct list victims;
+  size_t freed = 0;
+
+  list_init (&victims);
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->empty))
+    list_splice (list_end (&victims),
+                 list_begin (&c->empty), list_end (&c->empty));
+  c->slab_cnt -= c->empty_cnt;
+  c->empty_cnt = 0;
+  lock_release (&c->lock);
+
+  while (!list_empty (&victims)) 
+    {
+      palloc_free_page (list_entry (list_pop_front (&victims),
+                                    struct slab, elem));
+      freed++;
+    }
+  return freed;
+}
+
+/** Shrinks every cache.  Returns the number of pages freed. */
+size_t
+kmem_reap (void) 
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    freed += kmem_cache_shrink (list_entry (e, struct kmem_cache, elem));
+  return freed;
+}
+
+/** Returns the number of empty slabs in all caches. */
+static size_t
+slab_count (void *aux UNUSED) 
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e))
+    cnt += list_entry (e, struct kmem_cache, elem)->empty_cnt;
+  return cnt;
+}
+
+/** Shrinks caches until NR empty slabs have been freed or every
+   cache has been shrunk.  Returns the number of slabs freed. */
+static size_t
+slab_scan (size_t nr, void *aux UNUSED) 
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  for (e = list_begin (&caches); e != list_end (&caches) && freed < nr;
+       e = list_next (e))
+    freed += kmem_cache_shrink (list_entry (e, struct kmem_cache, elem));
+  return freed;
+}
+
+/** Prints statistics for every cache. */
+void
+kmem_print_stats (void) 
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&caches); e != list_end (&caches); e = list_next (e)) 
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu of %zu in use, %zu slabs\n",
+              c->name, c->obj_size, c->active_cnt,
+              c->slab_cnt * c->objs_per_slab, c->slab_cnt);
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/memtag.h"
+#include "threads/synch.h"
+
+/** Object caches.
+
+   A kmem_cache hands out objects of one exact size, carved from
+   page-sized slabs, so that frequently allocated kernel objects
+   neither round up to malloc()'s power-of-2 size classes nor
+   share free lists with unrelated objects.  Each slab is on one
+   of three lists: partial (some objects free), full (none free),
+   or empty (all free).  A freed object goes back to its own slab,
+   and allocation prefers partial slabs, so recently freed, cache-
+   warm objects are reused first.
+
+   An optional constructor initializes each object once, when its
+   slab is created; objects must be returned to the cache in
+   constructed state.  A few empty slabs are kept for reuse, and a
+   shrinker gives empty slabs back to the page allocator under
+   memory pressure. */
+
+/** Initializes an object when its slab is created. */
+typedef void kmem_ctor (void *obj);
+
+/** An object cache. */
+struct kmem_cache
+  {
+    char name[16];              /**< Name, for statistics. */
+    size_t obj_size;            /**< Size of each object, in bytes. */
+    size_t stride;              /**< Object size including free link. */
+    size_t objs_per_slab;       /**< Objects in each slab. */
+    kmem_ctor *ctor;            /**< Constructor, or null. */
+    enum mem_tag tag;           /**< Memory tag for objects. */
+    struct lock lock;           /**< Protects the rest. */
+    struct list partial;        /**< Slabs with some objects free. */
+    struct list full;           /**< Slabs with no objects free. */
+    struct list empty;          /**< Slabs with every object free. */
+    size_t empty_cnt;           /**< Number of slabs in `empty'. */
+    size_t slab_cnt;            /**< Number of slabs. */
+    size_t active_cnt;          /**< Objects in use. */
+    struct list_elem elem;      /**< Element in list of all caches. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor *, enum mem_tag);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+size_t kmem_cache_shrink (struct kmem_cache *);
+size_t kmem_reap (void);
+void kmem_print_stats (void);
+
+#endif /**< threads/slab.h */
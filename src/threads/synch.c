@@ -27,10 +27,30 @@
 */
 
 #include "threads/synch.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/** Lock statistics.  Only semaphores and locks given a name with
+   sema_set_name() or lock_set_name() are tracked, since every
+   tracked one stays on lockstat_list until shutdown.  A lock's
+   statistics are those of its semaphore plus hold times and
+   donations.  All updates happen with interrupts off. */
+bool lockstat_enabled;
+unsigned lockstat_top = 10;
+static struct list lockstat_list = LIST_INITIALIZER(lockstat_list);
+
+static void sema_wake(struct semaphore *sema);
+static struct semaphore_elem *semaphore_elem_of(struct waiter *w);
+static bool waiter_less(const struct heap_elem *, const struct heap_elem *,
+                        void *aux);
+static bool lockstat_tracked(const struct lockstat *);
+static void lockstat_add(int64_t *total, int64_t *max, int64_t time);
+static bool lockstat_more(const struct list_elem *,
+                          const struct list_elem *, void *aux);
 
 /** Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -46,7 +66,8 @@ sema_init(struct semaphore *sema, unsigned value) {
     ASSERT(sema != NULL);
 
     sema->value = value;
-    list_init(&sema->waiters);
+    wait_queue_init(&sema->waiters);
+    memset(&sema->stat, 0, sizeof sema->stat);
 }
 
 /** Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -59,15 +80,30 @@ sema_init(struct semaphore *sema, unsigned value) {
 void
 sema_down(struct semaphore *sema) {
     enum intr_level old_level;
+    bool tracked;
 
     ASSERT(sema != NULL);
     ASSERT(!intr_context());
 
     old_level = intr_disable();
-    while (sema->value == 0) {
-        list_push_back(&sema->waiters, &thread_current()->elem);
-        thread_block();
+    tracked = lockstat_tracked(&sema->stat);
+    if (sema->value == 0) {
+        int64_t start = tracked ? timer_ns() : 0;
+
+        while (sema->value == 0) {
+            struct waiter waiter;
+
+            wait_queue_push(&sema->waiters, &waiter);
+            thread_block();
+        }
+        if (tracked) {
+            sema->stat.contended++;
+            lockstat_add(&sema->stat.wait_total, &sema->stat.wait_max,
+                         timer_ns() - start);
+        }
     }
+    if (tracked)
+        sema->stat.acquired++;
     sema->value--;
     intr_set_level(old_level);
 }
@@ -87,6 +123,8 @@ sema_try_down(struct semaphore *sema) {
     old_level = intr_disable();
     if (sema->value > 0) {
         sema->value--;
+        if (lockstat_tracked(&sema->stat))
+            sema->stat.acquired++;
         success = true;
     } else
         success = false;
@@ -106,20 +144,42 @@ sema_up(struct semaphore *sema) {
     ASSERT(sema != NULL);
 
     old_level = intr_disable();
-    struct list_elem *max_elem;
-    if (!list_empty(&sema->waiters)){
-        max_elem = list_max(&sema->waiters, thread_list_priority_less, NULL);
-        list_remove(max_elem);
-        thread_unblock(list_entry(max_elem,struct thread, elem));
-        //thread_unblock (list_entry (list_pop_front (&sema->waiters),
-        //struct thread, elem));
-    }
-    sema->value++;
+    sema_wake(sema);
     thread_check_priority_yield(NULL);
     intr_set_level(old_level);
 }
 
+/** Names SEMA NAME and tracks its contention for lockstat.  SEMA
+   and NAME must stay valid until shutdown, so only long-lived
+   semaphores should be named, after sema_init(). */
+void
+sema_set_name(struct semaphore *sema, const char *name) {
+    enum intr_level old_level;
+
+    ASSERT(sema != NULL);
+    ASSERT(name != NULL);
+    ASSERT(sema->stat.name == NULL);
+
+    old_level = intr_disable();
+    sema->stat.name = name;
+    list_push_back(&lockstat_list, &sema->stat.elem);
+    intr_set_level(old_level);
+}
+
+/** Increments SEMA's value and unblocks its highest-priority
+   waiter, if any, without yielding to it.  Interrupts must be
+   off. */
+static void
+sema_wake(struct semaphore *sema) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!wait_queue_empty(&sema->waiters))
+        thread_unblock(wait_queue_pop(&sema->waiters)->thread);
+    sema->value++;
+}
+
 static void sema_test_helper(void *sema_);
+static void lock_take(struct lock *lock);
 
 /** Self-test for semaphores that makes control "ping-pong"
    between a pair of threads.  Insert calls to printf() to see
@@ -170,7 +230,7 @@ sema_test_helper(void *sema_) {
 void
 lock_init(struct lock *lock) {
     ASSERT(lock != NULL);
-    lock->priority = -1;
+    lock->priority = PRI_MIN - 1;
     lock->holder = NULL;
     sema_init(&lock->semaphore, 1);
 }
@@ -188,16 +248,17 @@ lock_acquire(struct lock *lock) {
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(!lock_held_by_current_thread(lock));
-    //enum intr_level old_level = intr_disable();
-    thread_current()->lock_wait = lock;
-    donate(lock, thread_current());
-    sema_down(&lock->semaphore);
-    lock->priority = thread_current()->priority_origin;
-    thread_current()->lock_wait = NULL;
-    lock->holder = thread_current();
-    list_push_back(&thread_current()->locks_hold, &lock->elem);
 
-    //intr_set_level(old_level);
+    struct thread *cur = thread_current();
+    enum intr_level old_level = intr_disable();
+    if (!thread_mlfqs && lock->holder != NULL) {
+        cur->lock_wait = lock;
+        donate(lock, cur);
+    }
+    sema_down(&lock->semaphore);
+    cur->lock_wait = NULL;
+    lock_take(lock);
+    intr_set_level(old_level);
 }
 
 /** Tries to acquires LOCK and returns true if successful or false
@@ -213,9 +274,11 @@ lock_try_acquire(struct lock *lock) {
     ASSERT(lock != NULL);
     ASSERT(!lock_held_by_current_thread(lock));
 
+    enum intr_level old_level = intr_disable();
     success = sema_try_down(&lock->semaphore);
     if (success)
-        lock->holder = thread_current();
+        lock_take(lock);
+    intr_set_level(old_level);
     return success;
 }
 
@@ -229,11 +292,41 @@ lock_release(struct lock *lock) {
     ASSERT(lock != NULL);
     ASSERT(lock_held_by_current_thread(lock));
 
-    recall_donates(lock);
-    lock->priority = -1;
+    enum intr_level old_level = intr_disable();
+    if (lockstat_tracked(&lock->semaphore.stat)) {
+        struct lockstat *stat = &lock->semaphore.stat;
+        lockstat_add(&stat->hold_total, &stat->hold_max,
+                     timer_ns() - stat->held_since);
+    }
+    if (!thread_mlfqs)
+        recall_donates(lock);
     lock->holder = NULL;
     sema_up(&lock->semaphore);
+    intr_set_level(old_level);
+}
 
+/** Makes the current thread the holder of LOCK, whose semaphore it
+   has just downed.  Threads still blocked on LOCK keep donating
+   to the new holder, so the lock's priority is recomputed from
+   them before it joins the holder's heap.  Interrupts must be
+   off. */
+static void
+lock_take(struct lock *lock) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    lock->holder = cur;
+    if (lockstat_tracked(&lock->semaphore.stat))
+        lock->semaphore.stat.held_since = timer_ns();
+    if (thread_mlfqs) return;
+
+    lock->priority = PRI_MIN - 1;
+    if (!wait_queue_empty(&lock->semaphore.waiters))
+        lock->priority = wait_queue_front(&lock->semaphore.waiters)->thread->priority;
+    heap_insert(&cur->locks_hold, &lock->elem);
+    if (lock->priority > cur->priority)
+        thread_update_priority(cur, lock->priority);
 }
 
 /** Returns true if the current thread holds LOCK, false
@@ -246,6 +339,74 @@ lock_held_by_current_thread(const struct lock *lock) {
     return lock->holder == thread_current();
 }
 
+/** Names LOCK NAME and tracks its contention for lockstat.  LOCK
+   and NAME must stay valid until shutdown, so only long-lived
+   locks should be named, after lock_init(). */
+void
+lock_set_name(struct lock *lock, const char *name) {
+    ASSERT(lock != NULL);
+
+    sema_set_name(&lock->semaphore, name);
+}
+
+/** Prints the lockstat_top tracked semaphores and locks that
+   threads spent the most time waiting for, if lockstat is
+   enabled.  Sorts the list of tracked ones, so it is meant to be
+   called once, at shutdown. */
+void
+lock_print_stats(void) {
+    struct list_elem *e;
+    enum intr_level old_level;
+    unsigned i;
+
+    if (!lockstat_enabled)
+        return;
+
+    old_level = intr_disable();
+    list_sort(&lockstat_list, lockstat_more, NULL);
+    printf("Lockstat: %zu tracked, top %u by wait time (us):\n",
+           list_size(&lockstat_list), lockstat_top);
+    for (e = list_begin(&lockstat_list), i = 0;
+         e != list_end(&lockstat_list) && i < lockstat_top;
+         e = list_next(e), i++) {
+        struct lockstat *s = list_entry(e, struct lockstat, elem);
+
+        printf("  %-16s %u acquired, %u contended, wait %lld/%lld, "
+               "hold %lld/%lld, %u donations\n",
+               s->name, s->acquired, s->contended,
+               s->wait_total / 1000, s->wait_max / 1000,
+               s->hold_total / 1000, s->hold_max / 1000, s->donations);
+    }
+    intr_set_level(old_level);
+}
+
+/** Returns true if STAT should be updated. */
+static bool
+lockstat_tracked(const struct lockstat *stat) {
+    return lockstat_enabled && stat->name != NULL;
+}
+
+/** Adds TIME to *TOTAL and raises *MAX to TIME if it is greater. */
+static void
+lockstat_add(int64_t *total, int64_t *max, int64_t time) {
+    *total += time;
+    if (time > *max)
+        *max = time;
+}
+
+/** Orders tracked semaphores and locks by time waited, most first,
+   then by contended acquisitions. */
+static bool
+lockstat_more(const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED) {
+    const struct lockstat *a = list_entry(a_, struct lockstat, elem);
+    const struct lockstat *b = list_entry(b_, struct lockstat, elem);
+
+    if (a->wait_total != b->wait_total)
+        return a->wait_total > b->wait_total;
+    return a->contended > b->contended;
+}
+
 
 
 /** Initializes condition variable COND.  A condition variable
@@ -255,7 +416,7 @@ void
 cond_init(struct condition *cond) {
     ASSERT(cond != NULL);
 
-    list_init(&cond->waiters);
+    wait_queue_init(&cond->waiters);
 }
 
 /** Atomically releases LOCK and waits for COND to be signaled by
@@ -281,6 +442,7 @@ cond_init(struct condition *cond) {
 void
 cond_wait(struct condition *cond, struct lock *lock) {
     struct semaphore_elem waiter;
+    enum intr_level old_level;
 
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
@@ -288,9 +450,9 @@ cond_wait(struct condition *cond, struct lock *lock) {
     ASSERT(lock_held_by_current_thread(lock));
 
     sema_init(&waiter.semaphore, 0);
-
-    waiter.priority = thread_get_priority();
-    list_push_back(&cond->waiters, &waiter.elem);
+    old_level = intr_disable();
+    wait_queue_push(&cond->waiters, &waiter.waiter);
+    intr_set_level(old_level);
     lock_release(lock);
     sema_down(&waiter.semaphore);
     lock_acquire(lock);
@@ -309,19 +471,18 @@ cond_signal(struct condition *cond, struct lock *lock UNUSED) {
     ASSERT(lock != NULL);
     ASSERT(!intr_context());
     ASSERT(lock_held_by_current_thread(lock));
-    if (!list_empty(&cond->waiters)){
-        //sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
-
-        struct list_elem *elem = list_max(&cond->waiters, cond_list_priority_less, NULL);
-        list_remove(elem);
-        sema_up(&list_entry(elem, struct semaphore_elem, elem)->semaphore);
-    }
 
+    enum intr_level old_level = intr_disable();
+    if (!wait_queue_empty(&cond->waiters))
+        sema_up(&semaphore_elem_of(wait_queue_pop(&cond->waiters))->semaphore);
+    intr_set_level(old_level);
 }
 
 
 /** Wakes up all threads, if any, waiting on COND (protected by
-   LOCK).  LOCK must be held before calling this function.
+   LOCK), in priority order.  LOCK must be held before calling
+   this function.  Costs O(n log n) for n waiters: the yield to a
+   higher-priority waiter is put off until all are awake.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -330,60 +491,158 @@ void
 cond_broadcast(struct condition *cond, struct lock *lock) {
     ASSERT(cond != NULL);
     ASSERT(lock != NULL);
+    ASSERT(!intr_context());
+    ASSERT(lock_held_by_current_thread(lock));
 
-    while (!list_empty(&cond->waiters))
-        cond_signal(cond, lock);
+    enum intr_level old_level = intr_disable();
+    while (!wait_queue_empty(&cond->waiters))
+        sema_wake(&semaphore_elem_of(wait_queue_pop(&cond->waiters))->semaphore);
+    thread_check_priority_yield(NULL);
+    intr_set_level(old_level);
 }
 
-void donate(struct lock *l, struct thread *requester){
-    if(l->holder == NULL) return;
-    //enum intr_level old_level = intr_disable();
-    if(l->priority < requester->priority){
+/** Returns the semaphore_elem that embeds waiter W. */
+static struct semaphore_elem *
+semaphore_elem_of(struct waiter *w) {
+    return (struct semaphore_elem *) ((uint8_t *) w
+                                      - offsetof(struct semaphore_elem, waiter));
+}
 
-        l->priority = requester->priority;
+/** Donates DONOR's priority along the chain of lock holders that
+   starts at L: L's holder, the holder of the lock that thread is
+   waiting on, and so on.  The chain is followed to its end, not
+   to a fixed depth; it stops early once a holder already runs at
+   DONOR's priority, since everything past it was raised by an
+   earlier donation.  A holder that turns out to be DONOR itself
+   means the chain has closed into a deadlock cycle, so the walk
+   stops there too.  Each step is O(log n) in the number of locks
+   the holder owns.  Interrupts must be off. */
+void
+donate(struct lock *l, struct thread *donor) {
+    int priority = donor->priority;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    while (l != NULL && l->holder != NULL && l->priority < priority) {
+        struct thread *holder = l->holder;
+
+        if (lockstat_tracked(&l->semaphore.stat))
+            l->semaphore.stat.donations++;
+        l->priority = priority;
+        heap_increase(&holder->locks_hold, &l->elem);
+        if (holder->priority >= priority || holder == donor)
+            break;
+        thread_update_priority(holder, priority);
+        l = holder->lock_wait;
+    }
+}
 
-        // update the priority of lock holder
-        l->holder->priority = requester->priority;
-        //if holder wait another lock
-        int times = 8;
-        while(l->holder->lock_wait && times){
-            requester = l->holder;
-            l = l->holder->lock_wait;
+/** Withdraws the donations made through L, which the current
+   thread is about to release, and drops the holder back to the
+   highest priority still donated through the locks it keeps.
+   Interrupts must be off. */
+void
+recall_donates(struct lock *l) {
+    struct thread *holder = l->holder;
 
-            if(l->priority < requester->priority) {
+    ASSERT(intr_get_level() == INTR_OFF);
 
-                l->priority = requester->priority;
+    heap_remove(&holder->locks_hold, &l->elem);
+    l->priority = PRI_MIN - 1;
+    thread_update_priority(holder, thread_effective_priority(holder));
+}
 
-                // update the priority of lock holder
-                l->holder->priority = requester->priority;
-            }
-            --times;
-        }
+/** Orders locks by the priority donated through them. */
+bool
+lock_heap_priority_less(const struct heap_elem *a,
+                        const struct heap_elem *b,
+                        void *aux UNUSED) {
+    return heap_entry(a, struct lock, elem)->priority
+           < heap_entry(b, struct lock, elem)->priority;
+}
 
-    }
-    //intr_set_level(old_level);
-}
-/* called when release lock */
-void recall_donates(struct lock *l){
-    //enum intr_level old_level = intr_disable();
-    list_remove(&l->elem);
-    if(!list_empty(&l->holder->locks_hold)){
-        l->holder->priority = list_entry(list_max(&l->holder->locks_hold, lock_list_priority_less, NULL), struct lock, elem)->priority;
-    }
-    else{
-        l->holder->priority = l->holder->priority_origin;
-    }
-    //intr_set_level(old_level);
+/** Initializes Q as an empty wait queue. */
+void
+wait_queue_init(struct wait_queue *q) {
+    heap_init(&q->heap, waiter_less, NULL);
+    q->next_seq = 0;
+}
+
+/** Returns true if no thread waits in Q. */
+bool
+wait_queue_empty(const struct wait_queue *q) {
+    return heap_empty(&q->heap);
+}
+
+/** Returns the number of threads waiting in Q. */
+size_t
+wait_queue_size(const struct wait_queue *q) {
+    return heap_size(&q->heap);
+}
 
+/** Adds the current thread to Q through W, which must stay valid
+   until W is popped.  A thread may wait in more than one queue
+   at a time, as cond_wait() does; each is kept in order as the
+   thread's priority changes.  Interrupts must be off. */
+void
+wait_queue_push(struct wait_queue *q, struct waiter *w) {
+    struct thread *cur = thread_current();
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    w->thread = cur;
+    w->queue = q;
+    w->seq = q->next_seq++;
+    w->outer = cur->waiting;
+    cur->waiting = w;
+    heap_insert(&q->heap, &w->elem);
 }
 
-bool lock_list_priority_less (const struct list_elem *a,
-                                const struct list_elem *b,
-                                void *aux){
-    return (list_entry(a,struct lock, elem)->priority) < (list_entry(b,struct lock,elem)->priority);
+/** Returns the highest-priority, longest-waiting waiter in Q,
+   which must not be empty. */
+struct waiter *
+wait_queue_front(const struct wait_queue *q) {
+    return heap_entry(heap_max(&q->heap), struct waiter, elem);
 }
 
-bool cond_list_priority_less (const struct list_elem *a, const struct list_elem *b, void *aux){
-    return (list_entry(a,struct semaphore_elem, elem)->priority) < (list_entry(b,struct semaphore_elem,elem)->priority);
-    //return true;
-}
\ No newline at end of file
+/** Removes and returns the highest-priority, longest-waiting
+   waiter in Q, which must not be empty.  O(log n) amortized.
+   Interrupts must be off. */
+struct waiter *
+wait_queue_pop(struct wait_queue *q) {
+    struct waiter *w = heap_entry(heap_pop_max(&q->heap), struct waiter, elem);
+    struct waiter **p;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (p = &w->thread->waiting; *p != w; p = &(*p)->outer)
+        ASSERT(*p != NULL);
+    *p = w->outer;
+    w->queue = NULL;
+    return w;
+}
+
+/** Restores the order of every wait queue T is in, after T's
+   priority changed.  Interrupts must be off. */
+void
+wait_queue_reorder(struct thread *t) {
+    struct waiter *w;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    for (w = t->waiting; w != NULL; w = w->outer)
+        heap_update(&w->queue->heap, &w->elem);
+}
+
+/** Orders waiters by their threads' current priority, then
+   earliest arrival first. */
+static bool
+waiter_less(const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) {
+    const struct waiter *a = heap_entry(a_, struct waiter, elem);
+    const struct waiter *b = heap_entry(b_, struct waiter, elem);
+
+    if (a->thread->priority != b->thread->priority)
+        return a->thread->priority < b->thread->priority;
+    return (int) (a->seq - b->seq) > 0;
+}
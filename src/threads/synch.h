@@ -1,28 +1,84 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Priority wait queue.  Waiters come out highest priority first
+   and in arrival order among equal priorities.  A waiter's place
+   follows its thread's priority while it waits, so donation to a
+   blocked thread moves it forward. */
+struct wait_queue 
+  {
+    struct heap heap;           /**< Max-heap of struct waiter. */
+    unsigned next_seq;          /**< Arrival stamp for the next waiter. */
+  };
+
+/** One thread's place in a wait queue.  Usually on the waiting
+   thread's stack. */
+struct waiter 
+  {
+    struct heap_elem elem;      /**< Element in `queue'. */
+    struct thread *thread;      /**< Waiting thread. */
+    struct wait_queue *queue;   /**< Queue holding this waiter. */
+    unsigned seq;               /**< Arrival stamp, for FIFO ties. */
+    struct waiter *outer;       /**< Thread's next waiter, or null. */
+  };
+
+void wait_queue_init (struct wait_queue *);
+bool wait_queue_empty (const struct wait_queue *);
+size_t wait_queue_size (const struct wait_queue *);
+void wait_queue_push (struct wait_queue *, struct waiter *);
+struct waiter *wait_queue_front (const struct wait_queue *);
+struct waiter *wait_queue_pop (struct wait_queue *);
+void wait_queue_reorder (struct thread *);
+
+/** Contention statistics of a named semaphore or lock, gathered
+   while lockstat is enabled.  Times are in nanoseconds. */
+struct lockstat 
+  {
+    const char *name;           /**< Name, or null if not tracked. */
+    struct list_elem elem;      /**< Element in list of tracked ones. */
+    unsigned acquired;          /**< Downs or acquisitions. */
+    unsigned contended;         /**< Those that had to wait. */
+    unsigned donations;         /**< Priority donations through a lock. */
+    int64_t wait_total;         /**< Time spent waiting. */
+    int64_t wait_max;           /**< Longest wait. */
+    int64_t hold_total;         /**< Time a lock was held. */
+    int64_t hold_max;           /**< Longest hold of a lock. */
+    int64_t held_since;         /**< When a lock was last acquired. */
+  };
+
+/** If true, gather lockstat statistics.  Controlled by kernel
+   command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+/** Number of locks lock_print_stats() prints. */
+extern unsigned lockstat_top;
 
 /** A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /**< Current value. */
-    struct list waiters;        /**< List of waiting threads. */
+    struct wait_queue waiters;  /**< Waiting threads. */
+    struct lockstat stat;       /**< Contention statistics. */
   };
 
-/** One semaphore in a list. */
-struct semaphore_elem {
-
-    struct list_elem elem;              /**< List element. */
-    int priority;
-    struct semaphore semaphore;         /**< This semaphore. */
-};
+/** One semaphore in a condition variable's wait queue. */
+struct semaphore_elem 
+  {
+    struct waiter waiter;       /**< Place in the condition's queue. */
+    struct semaphore semaphore; /**< This semaphore. */
+  };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_set_name (struct semaphore *, const char *);
 void sema_self_test (void);
 
 /** Lock. */
@@ -30,8 +86,8 @@ struct lock
   {
     struct thread *holder;      /**< Thread holding lock (for debugging). */
     struct semaphore semaphore; /**< Binary semaphore controlling access. */
-    int priority;
-    struct list_elem elem;
+    int priority;               /**< Highest priority donated by a waiter. */
+    struct heap_elem elem;      /**< Element in holder's locks_hold heap. */
   };
 
 void lock_init (struct lock *);
@@ -39,8 +95,10 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
-bool lock_list_priority_less (const struct list_elem *,
-                              const struct list_elem *,
+void lock_set_name (struct lock *, const char *);
+void lock_print_stats (void);
+bool lock_heap_priority_less (const struct heap_elem *,
+                              const struct heap_elem *,
                               void *);
 void donate(struct lock *, struct thread *);
 void recall_donates(struct lock *);
@@ -48,14 +106,13 @@ void recall_donates(struct lock *);
 /** Condition variable. */
 struct condition 
   {
-    struct list waiters;        /**< List of waiting threads. */
+    struct wait_queue waiters;  /**< Queue of struct semaphore_elem. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool cond_list_priority_less (const struct list_elem *a, const struct list_elem *b, void *aux);
 /** Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -5,9 +5,12 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/rcu.h"
+#include "threads/shrinker.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -22,16 +25,57 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/** List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/** Number of distinct thread priorities. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/** Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority, and bit P of
+   ready_bitmap is set if and only if ready_queues[P] is
+   nonempty, so the highest ready priority is a bit scan away.
+   With -stride or -cfs, stride_heap or cfs_tree takes their
+   place.  EDF threads rank above all of these, in edf_heap by
+   deadline, except that those waiting for their next period sit
+   on edf_throttled_list and do not count as ready. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static struct heap edf_heap;    /**< EDF threads, earliest deadline first. */
+static struct list edf_throttled_list; /**< EDF threads, by next release. */
+static struct heap stride_heap; /**< Instead of ready_queues, with -stride. */
+static struct rb_tree cfs_tree; /**< Instead of ready_queues, with -cfs. */
+static int cfs_tree_weight;     /**< Total weight of threads in cfs_tree. */
+static int64_t cfs_min_vruntime; /**< CFS virtual time; never decreases. */
+static size_t ready_cnt;        /**< Ready threads in all of the above. */
+
+/** Idle thread. */
+static struct thread *idle_thread;
 
 /** List of all processes.  Processes are added to this list
-   when they are first scheduled and removed when they exit. */
+   when they are first scheduled and removed when they exit.
+   Writers change it with interrupts off, through
+   rcu_list_insert() and rcu_list_remove(), so that a reader that
+   does not sleep may walk it under rcu_read_lock() instead.  A
+   dying thread's page is freed only after the context switch away
+   from it, which on a single CPU ends a grace period.
+   thread_foreach() walks it with interrupts off, and
+   thread_foreach_rcu() as an RCU reader. */
 static struct list all_list;
 
-/** Idle thread. */
-static struct thread *idle_thread;
+/** Cache of pages freed by dying threads, reused by
+   thread_create() without taking the palloc pool lock or clearing
+   the whole page: init_thread() clears struct thread, and the
+   stack needs no clearing.  Pages are chained through their first
+   word.  Accessed with interrupts off. */
+#define THREAD_CACHE_MAX 16
+static void *thread_cache;
+static size_t thread_cache_cnt;
+static size_t thread_cache_hits;    /**< Pages reused from the cache. */
+static size_t thread_cache_misses;  /**< Pages obtained from palloc. */
+
+/** Gives cached thread pages back under memory pressure. */
+static struct shrinker thread_cache_shrinker;
+static shrinker_count_func thread_cache_count;
+static shrinker_scan_func thread_cache_scan;
 
 /** Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
@@ -59,8 +103,94 @@ static unsigned thread_ticks;   /**< # of timer ticks since last yield. */
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
+
+/** If true, use the stride scheduler.  Controlled by kernel
+   command-line option "-stride". */
+bool thread_stride;
+
+/** Stride scheduling.  Each thread's stride is STRIDE1 divided by
+   its tickets, and every tick it runs adds its stride to its pass.
+   The ready thread with the lowest pass runs next, so over time
+   each thread runs in proportion to its tickets.
+   stride_global_pass is the pass of the thread most recently
+   picked to run, the lowest among runnable threads at the time.
+   New and newly woken threads start no lower, so that time spent
+   blocked does not turn into a burst of CPU on wakeup. */
+#define STRIDE1 (1 << 20)
+static int64_t stride_global_pass;
+
+/** If true, use the fair scheduler.  Controlled by kernel
+   command-line option "-cfs". */
+bool thread_cfs;
+
+/** Completely fair scheduling.  Each thread's vruntime advances by
+   the nanoseconds it actually runs, measured with timer_ns()
+   rather than in whole ticks, scaled by NICE_0_WEIGHT over its
+   weight.  The ready thread with the lowest vruntime runs next,
+   so over time each thread runs in proportion to its weight.
+
+   Instead of TIME_SLICE, the running thread gets its weighted
+   share of a scheduling period of CFS_LATENCY_NS, stretched so
+   that no thread's share is below CFS_MIN_GRANULARITY_NS.  Slices
+   can only end at a timer tick, though, so at TIMER_FREQ 100 a
+   thread runs at least one tick.  A waking thread preempts the
+   running thread only if it is behind by more than
+   CFS_WAKEUP_GRANULARITY_NS, to avoid switching back and forth
+   between threads that are nearly even. */
+#define NICE_0_WEIGHT 1024
+#define CFS_LATENCY_NS 40000000
+#define CFS_MIN_GRANULARITY_NS 4000000
+#define CFS_WAKEUP_GRANULARITY_NS 4000000
+static int64_t cfs_slice_start; /**< timer_ns() when the slice began. */
+
+/** Earliest-deadline-first real-time class.  A thread that calls
+   thread_set_deadline() runs jobs of up to RUNTIME ticks, one per
+   PERIOD, each due DEADLINE ticks after it is released.  Ready
+   EDF threads run before any other thread, earliest deadline
+   first.  Admission control keeps the sum of RUNTIME / DEADLINE
+   over all EDF threads within EDF_UTIL_MAX percent, which is
+   enough for every job to meet its deadline.  Each tick a job
+   runs is charged to its budget, and a job that exhausts its
+   budget is throttled until its next period, so that an overrun
+   cannot make other EDF threads miss or starve other threads.
+   Utilizations are fractions of EDF_UTIL_ONE. */
+#define EDF_UTIL_ONE (1 << 16)
+static int edf_util_total;
+
+/** Weight for each nice value from NICE_MIN to NICE_MAX.  Each
+   step is about 1.25 times the next, so that one nice level is
+   worth about 10% of CPU time between two competing threads. */
+static const int cfs_nice_weights[NICE_MAX - NICE_MIN + 1] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+    /*  20 */ 12,
+};
 static int load_avg;            /**< load_avg for advanced priority. Fixed-point number */
 
+/** Incremental MLFQS bookkeeping.  mlfqs_epoch counts load_avg
+   updates, one per second.  The recent_cpu decay coefficient of
+   each epoch is computed once and kept in a small ring, so a
+   sleeping thread's recent_cpu is decayed lazily when it wakes up
+   rather than every second.  Sleeping threads wait on
+   mlfqs_lazy_list in epoch order, and running or ready threads
+   whose recent_cpu changed wait on mlfqs_dirty_list to have
+   their priority recomputed.  Blocked threads that sit in a wait
+   queue are on mlfqs_waiting_list instead, and are decayed every
+   second like running threads: their priority orders the wait
+   queue, so it must not go stale. */
+#define MLFQS_EPOCH_HISTORY 64
+static unsigned mlfqs_epoch;
+static int mlfqs_decay_coef[MLFQS_EPOCH_HISTORY];
+static struct list mlfqs_lazy_list;
+static struct list mlfqs_dirty_list;
+static struct list mlfqs_waiting_list;
+
 static void kernel_thread(thread_func *, void *aux);
 
 static void idle(void *aux UNUSED);
@@ -71,6 +201,40 @@ static struct thread *next_thread_to_run(void);
 
 static void init_thread(struct thread *, const char *name, int priority);
 
+static void ready_queue_push(struct thread *);
+static void ready_queue_remove(struct thread *);
+static int ready_queue_max_priority(void);
+static struct thread *ready_queue_pop(void);
+static struct thread *thread_page_get(void);
+static bool stride_less(const struct heap_elem *, const struct heap_elem *,
+                        void *aux);
+static bool cfs_less(const struct rb_elem *, const struct rb_elem *,
+                     void *aux);
+static int cfs_weight(int nice);
+static void cfs_update_min(const struct thread *);
+static void cfs_update_curr(struct thread *);
+static void cfs_place(struct thread *);
+static bool cfs_tick(struct thread *);
+static bool cfs_check_preempt(struct thread *);
+static bool is_edf_thread(const struct thread *);
+static bool edf_less(const struct heap_elem *, const struct heap_elem *,
+                     void *aux);
+static bool edf_release_less(const struct list_elem *,
+                             const struct list_elem *, void *aux);
+static void edf_start_job(struct thread *, int64_t release);
+static bool edf_tick(struct thread *);
+static bool edf_check_preempt(void);
+static void thread_page_put(struct thread *);
+
+static void account_tick(struct thread *);
+
+static void mlfqs_catch_up(struct thread *);
+static void mlfqs_mark_dirty(struct thread *);
+static void mlfqs_update_load_avg(void);
+static void mlfqs_update_priorities(void);
+static void mlfqs_sleep(struct thread *);
+static void mlfqs_wake(struct thread *);
+
 static bool is_thread(struct thread *)UNUSED;
 static void *alloc_frame(struct thread *, size_t size);
 static void schedule(void);
@@ -94,11 +258,29 @@ static tid_t allocate_tid(void);
 void
 thread_init(void)
 {
+    int i;
+
     ASSERT(intr_get_level() == INTR_OFF);
 
     lock_init(&tid_lock);
-    list_init(&ready_list);
+    lock_set_name(&tid_lock, "tid");
+    heap_init(&edf_heap, edf_less, NULL);
+    list_init(&edf_throttled_list);
+    for (i = 0; i < PRI_CNT; i++)
+        list_init(&ready_queues[i]);
+    ready_bitmap = 0;
+    heap_init(&stride_heap, stride_less, NULL);
+    rb_init(&cfs_tree, cfs_less, NULL);
+    cfs_tree_weight = 0;
+    cfs_min_vruntime = 0;
+    ready_cnt = 0;
+    list_init(&mlfqs_lazy_list);
+    list_init(&mlfqs_dirty_list);
+    list_init(&mlfqs_waiting_list);
     list_init(&all_list);
+    rcu_init();
+    shrinker_register(&thread_cache_shrinker, "thread pages",
+                      thread_cache_count, thread_cache_scan, NULL);
 
     /* Set up a thread structure for the running thread. */
     initial_thread = running_thread();
@@ -120,7 +302,7 @@ thread_start(void) {
     /* Start preemptive thread scheduling. */
     intr_enable();
 
-    /* Wait for the idle thread to initialize idle_thread. */
+    /* Wait for the idle thread to register itself. */
     sema_down(&idle_started);
 }
 
@@ -130,6 +312,34 @@ void
 thread_tick(void) {
     struct thread *t = thread_current();
 
+    account_tick(t);
+
+    /* A tick outside a read-side critical section is a quiescent
+       state, even for a thread that runs without switching. */
+    if (t->rcu_nesting == 0)
+        rcu_quiescent_state(0);
+
+    /* Enforce preemption.  An EDF thread runs until it blocks, is
+       throttled, or a job with an earlier deadline is released. */
+    if (edf_tick(t))
+        intr_yield_on_return();
+    else if (!is_edf_thread(t)
+             && (thread_cfs ? cfs_tick(t) : ++thread_ticks >= TIME_SLICE))
+        intr_yield_on_return();
+}
+
+/** Accounts for a timer tick that passed while the idle thread
+   was halted with the periodic tick stopped.  Called by the
+   timer interrupt handler when it catches up in tickless mode. */
+void
+thread_idle_tick(void) {
+    account_tick(idle_thread);
+}
+
+/** Charges one timer tick to T in the statistics and, with the
+   MLFQS, runs the per-tick bookkeeping. */
+static void
+account_tick(struct thread *t) {
     /* Update statistics. */
     if (t == idle_thread)
         idle_ticks++;
@@ -143,27 +353,21 @@ thread_tick(void) {
     if(thread_mlfqs)
     {
         int64_t ticks = timer_ticks();
-        struct thread *cur = thread_current();
-
-        cur->recent_cpu = ADD_X_N(cur->recent_cpu, 1);
 
-        if (ticks % TIMER_FREQ == 0)
+        if (t != idle_thread)
         {
-            calculate_load_avg();
-            /* recent_cpu depends on load_avg */
-            list_apply(&all_list, calculate_recent_cpu, NULL);
+            t->recent_cpu = ADD_X_N(t->recent_cpu, 1);
+            mlfqs_mark_dirty(t);
         }
+
+        if (ticks % TIMER_FREQ == 0)
+            mlfqs_update_load_avg();
         if (ticks % TIME_SLICE == 0)
-        {
-            list_apply(&all_list, calculate_priority, NULL);
-        }
+            mlfqs_update_priorities();
     }
 
-    /* Enforce preemption. */
-    if (++thread_ticks >= TIME_SLICE)
-        intr_yield_on_return();
-
-    //thread_check_priority_yield(NULL);
+    if (thread_stride && t != idle_thread)
+        t->pass += t->stride;
 }
 
 /** Prints thread statistics. */
@@ -173,6 +377,17 @@ thread_print_stats(void) {
            idle_ticks, kernel_ticks, user_ticks);
 }
 
+/** Stores the number of thread pages thread_create() has reused
+   from the page cache in *HITS, and the number it has had to get
+   from palloc in *MISSES. */
+void
+thread_cache_stats(size_t *hits, size_t *misses) {
+    enum intr_level old_level = intr_disable();
+    *hits = thread_cache_hits;
+    *misses = thread_cache_misses;
+    intr_set_level(old_level);
+}
+
 /** Creates a new kernel thread named NAME with the given initial
    PRIORITY, which executes FUNCTION passing AUX as the argument,
    and adds it to the ready queue.  Returns the thread identifier
@@ -200,7 +415,7 @@ thread_create(const char *name, int priority,
     ASSERT(function != NULL);
 
     /* Allocate thread. */
-    t = palloc_get_page(PAL_ZERO);
+    t = thread_page_get();
     if (t == NULL)
         return TID_ERROR;
 
@@ -239,7 +454,12 @@ void
 thread_block(void) {
     ASSERT(!intr_context());
     ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(thread_current()->rcu_nesting == 0);
 
+    if (thread_mlfqs)
+        mlfqs_sleep(thread_current());
+    if (thread_cfs)
+        cfs_update_curr(thread_current());
     thread_current()->status = THREAD_BLOCKED;
     schedule();
 }
@@ -260,8 +480,21 @@ thread_unblock(struct thread *t) {
 
     old_level = intr_disable();
     ASSERT(t->status == THREAD_BLOCKED);
-    list_push_back(&ready_list, &t->elem);
+    if (thread_mlfqs && t != idle_thread)
+        mlfqs_wake(t);
+    if (thread_stride && t->pass < stride_global_pass)
+        t->pass = stride_global_pass;
+    if (thread_cfs)
+        cfs_place(t);
+    if (is_edf_thread(t)) {
+        int64_t now = timer_ticks();
+
+        /* Waking after its deadline starts a new job. */
+        if (now >= t->edf_deadline)
+            edf_start_job(t, now);
+    }
     t->status = THREAD_READY;
+    ready_queue_push(t);
     intr_set_level(old_level);
 }
 
@@ -309,7 +542,10 @@ thread_exit(void) {
        and schedule another process.  That process will destroy us
        when it calls thread_schedule_tail(). */
     intr_disable();
-    list_remove(&thread_current()->allelem);
+    rcu_list_remove(&thread_current()->allelem);
+    edf_util_total -= thread_current()->edf_util;
+    if (thread_current()->mlfqs_dirty)
+        list_remove(&thread_current()->mlfqs_elem);
     thread_current()->status = THREAD_DYING;
     schedule();
     NOT_REACHED();
@@ -323,32 +559,46 @@ thread_yield(void) {
     enum intr_level old_level;
 
     ASSERT(!intr_context());
+    ASSERT(cur->rcu_nesting == 0);
 
     old_level = intr_disable();
-    if (cur != idle_thread)
-        list_push_back(&ready_list, &cur->elem);
+    if (thread_cfs)
+        cfs_update_curr(cur);
     cur->status = THREAD_READY;
+    if (cur != idle_thread)
+        ready_queue_push(cur);
     schedule();
     intr_set_level(old_level);
 }
 
+/** Yields the CPU on the way out of an interrupt handler that
+   called intr_yield_on_return().  If the interrupted thread is in
+   an RCU read-side critical section, rcu_read_unlock() yields
+   instead once it leaves. */
+void
+thread_preempt(void) {
+    struct thread *cur = thread_current();
+
+    if (cur->rcu_nesting > 0)
+        cur->rcu_preempted = true;
+    else
+        thread_yield();
+}
+
 
 /** Sets the current thread's priority to NEW_PRIORITY. */
 void
 thread_set_priority(int new_priority) {
-    if (thread_mlfqs) return;
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
 
-    if(thread_current()->priority == thread_current()->priority_origin){
-        thread_current()->priority = new_priority;
-    }
-    if(thread_current()->priority_origin > new_priority){
-        thread_current()->priority_origin = new_priority;
-        thread_check_priority_yield(NULL);
-    }
-    else{
-        thread_current()->priority_origin = new_priority;
-    }
+    if (thread_mlfqs || thread_stride || thread_cfs) return;
 
+    old_level = intr_disable();
+    cur->priority_origin = new_priority;
+    thread_update_priority(cur, thread_effective_priority(cur));
+    thread_check_priority_yield(NULL);
+    intr_set_level(old_level);
 }
 
 /** Returns the current thread's priority. */
@@ -362,10 +612,15 @@ void
 thread_set_nice(int nice) {
     struct thread *cur = thread_current();
     cur->nice = nice;
-    calculate_priority(&cur->allelem, NULL);
-    if(cur->priority < list_entry(list_max(&all_list, thread_alllist_priority_less, NULL), struct thread, allelem)->priority){
-        thread_yield();
-    }
+    if (thread_cfs) {
+        /* Charge the time run so far at the old weight. */
+        enum intr_level old_level = intr_disable();
+        cfs_update_curr(cur);
+        cur->weight = cfs_weight(nice);
+        intr_set_level(old_level);
+    } else
+        calculate_priority(&cur->allelem, NULL);
+    thread_check_priority_yield(NULL);
 }
 
 /** Returns the current thread's nice value. */
@@ -374,6 +629,113 @@ thread_get_nice(void) {
     return thread_current ()->nice;
 }
 
+/** Gives the current thread TICKETS tickets, which takes effect
+   on its stride from the next tick on. */
+void
+thread_set_tickets(int tickets) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(TICKETS_MIN <= tickets && tickets <= TICKETS_MAX);
+
+    old_level = intr_disable();
+    cur->tickets = tickets;
+    cur->stride = STRIDE1 / tickets;
+    intr_set_level(old_level);
+}
+
+/** Returns the current thread's tickets. */
+int
+thread_get_tickets(void) {
+    return thread_current()->tickets;
+}
+
+/** Makes the current thread an EDF real-time thread that runs a
+   job of up to RUNTIME ticks every PERIOD ticks, each due
+   DEADLINE ticks after it is released, starting with a job
+   released now.  0 < RUNTIME <= DEADLINE <= PERIOD.  Returns
+   false, leaving the thread as it was, if admitting the thread
+   would raise the total utilization of EDF threads above
+   EDF_UTIL_MAX percent.  A thread that is already an EDF thread
+   may change its parameters this way.
+
+   Always returns false with -mlfqs.  The MLFQS scheduler decays
+   every thread's recent_cpu each second, but ready and throttled
+   EDF threads sit outside the lists it catches up. */
+bool
+thread_set_deadline(int64_t runtime, int64_t period, int64_t deadline) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+    int util;
+    bool admitted;
+
+    ASSERT(0 < runtime && runtime <= deadline && deadline <= period);
+
+    if (thread_mlfqs)
+        return false;
+
+    /* Round up, so that rounding never admits too much. */
+    util = (runtime * EDF_UTIL_ONE + deadline - 1) / deadline;
+
+    old_level = intr_disable();
+    admitted = (edf_util_total - cur->edf_util + util
+                <= EDF_UTIL_ONE / 100 * EDF_UTIL_MAX);
+    if (admitted) {
+        edf_util_total += util - cur->edf_util;
+        cur->edf_util = util;
+        cur->edf_runtime = runtime;
+        cur->edf_period = period;
+        cur->edf_rel_deadline = deadline;
+        cur->edf_throttled = false;
+        edf_start_job(cur, timer_ticks());
+    }
+    intr_set_level(old_level);
+    return admitted;
+}
+
+/** Returns the current thread, which must be an EDF thread, to
+   the scheduling class it had before thread_set_deadline(). */
+void
+thread_clear_deadline(void) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(is_edf_thread(cur));
+
+    old_level = intr_disable();
+    edf_util_total -= cur->edf_util;
+    cur->edf_util = 0;
+    cur->edf_runtime = cur->edf_period = cur->edf_rel_deadline = 0;
+    cur->edf_throttled = false;
+    thread_check_priority_yield(NULL);
+    intr_set_level(old_level);
+}
+
+/** Ends the current EDF thread's job and waits for its next
+   period.  Counts a deadline miss if the job ended late. */
+void
+thread_deadline_yield(void) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level;
+
+    ASSERT(is_edf_thread(cur));
+
+    old_level = intr_disable();
+    if (timer_ticks() > cur->edf_deadline)
+        cur->edf_misses++;
+    cur->edf_throttled = true;
+    thread_yield();
+    intr_set_level(old_level);
+}
+
+/** Returns the number of the current thread's EDF jobs that
+   missed their deadlines, by ending late or by overrunning their
+   budget. */
+int
+thread_deadline_misses(void) {
+    return thread_current()->edf_misses;
+}
+
 /** Returns 100 times the system load average. */
 int
 thread_get_load_avg(void) {
@@ -406,6 +768,23 @@ idle(void *idle_started_ UNUSED) {
         intr_disable();
         thread_block();
 
+        /* Nothing to run.  Spend the time zeroing a free page for
+           later PAL_ZERO requests, then look again, unless there
+           are enough zeroed pages already. */
+        intr_enable();
+        if (palloc_zero_idle())
+            continue;
+        intr_disable();
+        if (ready_cnt > 0)
+            continue;
+
+        /* In tickless mode, stop the periodic
+           tick until there is timer work to do, unless a throttled
+           EDF thread needs the tick for its next period or RCU
+           callbacks need it to finish their grace period. */
+        if (list_empty(&edf_throttled_list) && !rcu_pending())
+            timer_idle_enter();
+
         /* Re-enable interrupts and wait for the next one.
 
            The `sti' instruction disables interrupts until the
@@ -461,6 +840,10 @@ init_thread(struct thread *t, const char *name, int priority) {
     ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
     ASSERT(name != NULL);
 
+    /* The stride and fair schedulers do not use priorities. */
+    if (thread_stride || thread_cfs)
+        priority = PRI_DEFAULT;
+
     memset(t, 0, sizeof *t);
     t->status = THREAD_BLOCKED;
     strlcpy(t->name, name, sizeof t->name);
@@ -469,7 +852,17 @@ init_thread(struct thread *t, const char *name, int priority) {
     t->priority = priority;
     t->lock_wait = NULL;
     t->magic = THREAD_MAGIC;
-    list_init(&t->locks_hold);
+    heap_init(&t->locks_hold, lock_heap_priority_less, NULL);
+    t->waiting = NULL;
+    t->fpu = NULL;
+    t->tickets = TICKETS_DEFAULT;
+    t->stride = STRIDE1 / TICKETS_DEFAULT;
+    t->pass = stride_global_pass;
+    if (thread_cfs) {
+        t->nice = t == initial_thread ? NICE_INITIAL : thread_current()->nice;
+        t->weight = cfs_weight(t->nice);
+        t->vruntime = cfs_min_vruntime;
+    }
     if (thread_mlfqs)
     {
         if (t == initial_thread)
@@ -482,11 +875,16 @@ init_thread(struct thread *t, const char *name, int priority) {
             t->recent_cpu = thread_current()->recent_cpu;
             t->nice = thread_current()->nice;
         }
+        t->mlfqs_epoch = mlfqs_epoch;
 
         calculate_priority(&t->allelem, NULL);
     }
     old_level = intr_disable();
-    list_push_back(&all_list, &t->allelem);
+    rcu_list_insert(list_end(&all_list), &t->allelem);
+    /* A new thread starts out blocked, so it goes on the lazy list
+       until thread_unblock() takes it off again. */
+    if (thread_mlfqs && t != initial_thread)
+        list_push_back(&mlfqs_lazy_list, &t->mlfqs_elem);
     intr_set_level(old_level);
 }
 
@@ -509,15 +907,157 @@ alloc_frame(struct thread *t, size_t size) {
    idle_thread. */
 static struct thread *
 next_thread_to_run(void) {
-    if (list_empty(&ready_list))
-        return idle_thread;
-    else{
-        struct list_elem *max_elem = list_max(&ready_list, thread_list_priority_less, NULL);
-        list_remove(max_elem);
-        return list_entry(max_elem,struct thread, elem);
-        //return list_entry (list_pop_back (&ready_list), struct thread, elem);
+    struct thread *t = ready_queue_pop();
+
+    return t != NULL ? t : idle_thread;
+}
+
+/** Appends T, which must be in THREAD_READY state, to the queue
+   for its priority in the run queue.  Interrupts must be off. */
+static void
+ready_queue_push(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+    ASSERT(t->status == THREAD_READY);
+
+    if (is_edf_thread(t)) {
+        if (t->edf_throttled) {
+            list_insert_ordered(&edf_throttled_list, &t->elem,
+                                edf_release_less, NULL);
+            return;
+        }
+        heap_insert(&edf_heap, &t->edf_elem);
+    } else if (thread_stride)
+        heap_insert(&stride_heap, &t->stride_elem);
+    else if (thread_cfs) {
+        rb_insert(&cfs_tree, &t->cfs_elem);
+        cfs_tree_weight += t->weight;
+    } else {
+        list_push_back(&ready_queues[t->priority], &t->elem);
+        ready_bitmap |= (uint64_t) 1 << t->priority;
     }
+    ready_cnt++;
+}
+
+/** Removes T from the run queue.  Interrupts must be off. */
+static void
+ready_queue_remove(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
 
+    if (is_edf_thread(t)) {
+        if (t->edf_throttled) {
+            list_remove(&t->elem);
+            return;
+        }
+        heap_remove(&edf_heap, &t->edf_elem);
+    } else if (thread_stride)
+        heap_remove(&stride_heap, &t->stride_elem);
+    else if (thread_cfs) {
+        rb_remove(&cfs_tree, &t->cfs_elem);
+        cfs_tree_weight -= t->weight;
+    } else {
+        list_remove(&t->elem);
+        if (list_empty(&ready_queues[t->priority]))
+            ready_bitmap &= ~((uint64_t) 1 << t->priority);
+    }
+    ready_cnt--;
+}
+
+/** Returns the highest priority among THREAD_READY threads, or
+   -1 if the run queue is empty.  Scans 32 bits at a time so that
+   the compiler emits a plain `bsr' rather than a libgcc call. */
+static int
+ready_queue_max_priority(void) {
+    uint32_t high = ready_bitmap >> 32;
+    uint32_t low = ready_bitmap;
+
+    if (high != 0)
+        return 63 - __builtin_clz(high);
+    if (low != 0)
+        return 31 - __builtin_clz(low);
+    return -1;
+}
+
+/** Removes and returns a thread of the highest priority in the
+   run queue, the one that has waited longest, or a null pointer
+   if the run queue is empty.  With the stride scheduler, takes
+   the thread with the lowest pass instead, in O(log n), and with
+   the fair scheduler the one with the lowest vruntime, in O(1)
+   plus O(log n) to rebalance.  A ready EDF thread, earliest
+   deadline first, comes before all of these.  Interrupts must be
+   off. */
+static struct thread *
+ready_queue_pop(void) {
+    struct thread *t = NULL;
+    int priority;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (!heap_empty(&edf_heap)) {
+        t = heap_entry(heap_pop_max(&edf_heap), struct thread, edf_elem);
+        ready_cnt--;
+        return t;
+    }
+    if (thread_stride) {
+        if (!heap_empty(&stride_heap)) {
+            t = heap_entry(heap_pop_max(&stride_heap),
+                           struct thread, stride_elem);
+            stride_global_pass = t->pass;
+            ready_cnt--;
+        }
+        return t;
+    }
+    if (thread_cfs) {
+        struct rb_elem *e = rb_min(&cfs_tree);
+
+        if (e != NULL) {
+            t = rb_entry(e, struct thread, cfs_elem);
+            rb_remove(&cfs_tree, e);
+            cfs_tree_weight -= t->weight;
+            ready_cnt--;
+            cfs_update_min(t);
+        }
+        return t;
+    }
+
+    priority = ready_queue_max_priority();
+    if (priority >= 0) {
+        struct list *q = &ready_queues[priority];
+
+        t = list_entry(list_pop_front(q), struct thread, elem);
+        if (list_empty(q))
+            ready_bitmap &= ~((uint64_t) 1 << priority);
+        ready_cnt--;
+    }
+    return t;
+}
+
+/** Changes T's effective priority to PRIORITY.  If T is waiting
+   in the run queue, it moves to the tail of the queue for its
+   new priority.  If T is in any wait queue, those are reordered
+   too, whatever T's status: a thread joins a wait queue while
+   still running, and may be preempted there, as between
+   wait_queue_push() and thread_block() or inside cond_wait().
+   Donation and MLFQS recomputation thus keep every queue
+   consistent.  Does not preempt the running thread. */
+void
+thread_update_priority(struct thread *t, int priority) {
+    enum intr_level old_level;
+
+    ASSERT(is_thread(t));
+    ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+    old_level = intr_disable();
+    if (t->priority != priority) {
+        if (t->status == THREAD_READY && t != idle_thread) {
+            ready_queue_remove(t);
+            t->priority = priority;
+            ready_queue_push(t);
+        } else
+            t->priority = priority;
+        if (t->waiting != NULL)
+            wait_queue_reorder(t);
+    }
+    intr_set_level(old_level);
 }
 
 /** Completes a thread switch by activating the new thread's page
@@ -547,6 +1087,12 @@ thread_schedule_tail(struct thread *prev) {
 
     /* Start new time slice. */
     thread_ticks = 0;
+    if (thread_cfs)
+        cfs_slice_start = cur->exec_start = timer_ns();
+
+    /* Make our first FPU instruction trap if another thread's FPU
+       state is loaded. */
+    fpu_switch(cur);
 
 #ifdef USERPROG
     /* Activate the new address space. */
@@ -558,9 +1104,11 @@ thread_schedule_tail(struct thread *prev) {
        pull out the rug under itself.  (We don't free
        initial_thread because its memory was not obtained via
        palloc().) */
-    if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) {
+    if (prev != NULL && prev->status == THREAD_DYING) {
         ASSERT(prev != cur);
-        palloc_free_page(prev);
+        fpu_release(prev);
+        if (prev != initial_thread)
+            thread_page_put(prev);
     }
 }
 
@@ -581,11 +1129,315 @@ schedule(void) {
     ASSERT(cur->status != THREAD_RUNNING);
     ASSERT(is_thread(next));
 
+    if (cur == idle_thread)
+        timer_idle_exit();
+    rcu_quiescent_state(0);
+
     if (cur != next)
         prev = switch_threads(cur, next);
     thread_schedule_tail(prev);
 }
 
+/** Orders threads in a stride heap so that the one with the lowest
+   pass, or among equal passes the lowest tid, is the maximum. */
+static bool
+stride_less(const struct heap_elem *a_, const struct heap_elem *b_,
+            void *aux UNUSED) {
+    const struct thread *a = heap_entry(a_, struct thread, stride_elem);
+    const struct thread *b = heap_entry(b_, struct thread, stride_elem);
+
+    if (a->pass != b->pass)
+        return a->pass > b->pass;
+    return a->tid > b->tid;
+}
+
+/** Orders threads in a CFS tree by vruntime.  The tree keeps equal
+   vruntimes in insertion order. */
+static bool
+cfs_less(const struct rb_elem *a_, const struct rb_elem *b_,
+         void *aux UNUSED) {
+    const struct thread *a = rb_entry(a_, struct thread, cfs_elem);
+    const struct thread *b = rb_entry(b_, struct thread, cfs_elem);
+
+    return a->vruntime < b->vruntime;
+}
+
+/** Returns the CFS weight of a thread with the given NICE value. */
+static int
+cfs_weight(int nice) {
+    ASSERT(NICE_MIN <= nice && nice <= NICE_MAX);
+    return cfs_nice_weights[nice - NICE_MIN];
+}
+
+/** Raises cfs_min_vruntime to the least vruntime among the
+   threads in cfs_tree and CUR, the running thread, but never
+   lowers it.  Interrupts must be off. */
+static void
+cfs_update_min(const struct thread *cur) {
+    int64_t vruntime = cur->vruntime;
+    struct rb_elem *e = rb_min(&cfs_tree);
+
+    if (e != NULL) {
+        int64_t leftmost = rb_entry(e, struct thread, cfs_elem)->vruntime;
+        if (leftmost < vruntime)
+            vruntime = leftmost;
+    }
+    if (vruntime > cfs_min_vruntime)
+        cfs_min_vruntime = vruntime;
+}
+
+/** Charges running thread CUR's vruntime for the time it has run
+   since it was last charged.  Interrupts must be off. */
+static void
+cfs_update_curr(struct thread *cur) {
+    int64_t now, delta;
+
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (cur == idle_thread)
+        return;
+
+    now = timer_ns();
+    delta = now - cur->exec_start;
+    if (delta > 0) {
+        cur->vruntime += delta * NICE_0_WEIGHT / cur->weight;
+        cur->exec_start = now;
+    }
+
+    cfs_update_min(cur);
+}
+
+/** Places waking thread T no more than half a scheduling period
+   behind cfs_min_vruntime.  A thread that slept gets
+   ahead of those that kept running, but not by the whole time it
+   slept, which would let it monopolize the CPU.  Interrupts must
+   be off. */
+static void
+cfs_place(struct thread *t) {
+    int64_t floor = cfs_min_vruntime - CFS_LATENCY_NS / 2;
+
+    if (t->vruntime < floor)
+        t->vruntime = floor;
+}
+
+/** Charges the running thread CUR for the tick and returns true
+   if its time slice has run out and another thread is ready.
+   Called from the timer interrupt. */
+static bool
+cfs_tick(struct thread *cur) {
+    int64_t period = CFS_LATENCY_NS;
+    int64_t slice;
+
+    if (cur == idle_thread)
+        return !rb_empty(&cfs_tree);
+    cfs_update_curr(cur);
+    if (rb_empty(&cfs_tree))
+        return false;
+
+    /* With many threads ready, stretch the period rather than
+       cutting slices below the minimum granularity. */
+    if ((int64_t) (ready_cnt + 1) * CFS_MIN_GRANULARITY_NS > period)
+        period = (int64_t) (ready_cnt + 1) * CFS_MIN_GRANULARITY_NS;
+    slice = period * cur->weight / (cfs_tree_weight + cur->weight);
+    if (slice < CFS_MIN_GRANULARITY_NS)
+        slice = CFS_MIN_GRANULARITY_NS;
+
+    return cur->exec_start - cfs_slice_start >= slice;
+}
+
+/** Returns true if T, or the ready thread with the lowest vruntime
+   if T is null, should preempt the running thread. */
+static bool
+cfs_check_preempt(struct thread *t) {
+    struct thread *cur = thread_current();
+    enum intr_level old_level = intr_disable();
+    bool preempt = false;
+
+    if (t == NULL) {
+        struct rb_elem *e = rb_min(&cfs_tree);
+        if (e != NULL)
+            t = rb_entry(e, struct thread, cfs_elem);
+    }
+    if (t != NULL && t != cur && t->status == THREAD_READY) {
+        if (cur == idle_thread)
+            preempt = true;
+        else {
+            cfs_update_curr(cur);
+            preempt = t->vruntime + CFS_WAKEUP_GRANULARITY_NS < cur->vruntime;
+        }
+    }
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/** Returns true if T is an EDF real-time thread. */
+static bool
+is_edf_thread(const struct thread *t) {
+    return t->edf_period != 0;
+}
+
+/** Orders threads in an EDF heap so that the one with the earliest
+   deadline, or among equal deadlines the lowest tid, is the
+   maximum. */
+static bool
+edf_less(const struct heap_elem *a_, const struct heap_elem *b_,
+         void *aux UNUSED) {
+    const struct thread *a = heap_entry(a_, struct thread, edf_elem);
+    const struct thread *b = heap_entry(b_, struct thread, edf_elem);
+
+    if (a->edf_deadline != b->edf_deadline)
+        return a->edf_deadline > b->edf_deadline;
+    return a->tid > b->tid;
+}
+
+/** Orders throttled EDF threads by the start of their next
+   period. */
+static bool
+edf_release_less(const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED) {
+    const struct thread *a = list_entry(a_, struct thread, elem);
+    const struct thread *b = list_entry(b_, struct thread, elem);
+
+    return a->edf_release + a->edf_period < b->edf_release + b->edf_period;
+}
+
+/** Starts a new job of EDF thread T, released at tick RELEASE,
+   with a full budget. */
+static void
+edf_start_job(struct thread *t, int64_t release) {
+    t->edf_release = release;
+    t->edf_deadline = release + t->edf_rel_deadline;
+    t->edf_budget = t->edf_runtime;
+}
+
+/** Charges the tick to running thread CUR's EDF budget and
+   releases the jobs of throttled threads whose next period has
+   begun.  Returns true if CUR should yield, because it was
+   throttled or a job with an earlier deadline became ready.
+   Called from the timer interrupt. */
+static bool
+edf_tick(struct thread *cur) {
+    int64_t now = timer_ticks();
+    bool released = false;
+    bool resched = false;
+
+    for (;;) {
+        struct thread *t = NULL;
+
+        if (!list_empty(&edf_throttled_list)) {
+            t = list_entry(list_front(&edf_throttled_list),
+                           struct thread, elem);
+            if (t->edf_release + t->edf_period <= now)
+                list_pop_front(&edf_throttled_list);
+            else
+                t = NULL;
+        }
+        if (t == NULL)
+            break;
+
+        /* A period that began during a late tick still starts at
+           its own boundary, unless a whole period was missed. */
+        t->edf_throttled = false;
+        edf_start_job(t, t->edf_release + t->edf_period);
+        if (t->edf_deadline <= now)
+            edf_start_job(t, now);
+        ready_queue_push(t);
+        released = true;
+    }
+
+    if (is_edf_thread(cur) && !cur->edf_throttled
+        && --cur->edf_budget <= 0) {
+        /* An overrunning job cannot meet its deadline, which comes
+           no later than its next period. */
+        cur->edf_misses++;
+        cur->edf_throttled = true;
+        resched = true;
+    }
+
+    return resched || (released && edf_check_preempt());
+}
+
+/** Returns true if the ready EDF thread with the earliest deadline
+   should preempt the running thread, which it does
+   unless the running thread is an EDF thread with an earlier or
+   equal deadline. */
+static bool
+edf_check_preempt(void) {
+    struct thread *cur = thread_current();
+    struct heap *h = &edf_heap;
+    enum intr_level old_level = intr_disable();
+    bool preempt = false;
+
+    if (!heap_empty(h)) {
+        struct thread *t = heap_entry(heap_max(h), struct thread, edf_elem);
+        preempt = !is_edf_thread(cur) || t->edf_deadline < cur->edf_deadline;
+    }
+    intr_set_level(old_level);
+    return preempt;
+}
+
+/** Returns a page for a new thread's struct thread and stack,
+   from the page cache if possible, or a null pointer if memory is
+   exhausted.  The page's contents are arbitrary. */
+static struct thread *
+thread_page_get(void) {
+    enum intr_level old_level = intr_disable();
+    void *page = thread_cache;
+
+    if (page != NULL) {
+        thread_cache = *(void **) page;
+        thread_cache_cnt--;
+        thread_cache_hits++;
+    } else
+        thread_cache_misses++;
+    intr_set_level(old_level);
+
+    return page != NULL ? page : palloc_get_page(PAL_TAG(MEM_THREAD));
+}
+
+/** Gives dead thread T's page back to the page cache, or to palloc
+   if the cache is full.  Interrupts must be off. */
+static void
+thread_page_put(struct thread *t) {
+    ASSERT(intr_get_level() == INTR_OFF);
+
+    if (thread_cache_cnt < THREAD_CACHE_MAX) {
+        *(void **) t = thread_cache;
+        thread_cache = t;
+        thread_cache_cnt++;
+    } else
+        palloc_free_page(t);
+}
+
+/** Returns the number of pages in the thread page cache. */
+static size_t
+thread_cache_count(void *aux UNUSED) {
+    return thread_cache_cnt;
+}
+
+/** Frees up to NR pages from the thread page cache.  Returns the
+   number freed. */
+static size_t
+thread_cache_scan(size_t nr, void *aux UNUSED) {
+    size_t freed;
+
+    for (freed = 0; freed < nr; freed++) {
+        enum intr_level old_level = intr_disable();
+        void *page = thread_cache;
+
+        if (page != NULL) {
+            thread_cache = *(void **) page;
+            thread_cache_cnt--;
+        }
+        intr_set_level(old_level);
+
+        if (page == NULL)
+            break;
+        palloc_free_page(page);
+    }
+    return freed;
+}
+
 /** Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid(void) {
@@ -616,11 +1468,42 @@ bool thread_alllist_priority_less (const struct list_elem *a,
 }
 
 
+/** Returns the priority T should run at: its own priority or the
+   highest priority donated through any lock it holds, whichever
+   is greater.  O(1), since held locks are kept in a max-heap. */
+int
+thread_effective_priority(const struct thread *t) {
+    int priority = t->priority_origin;
+
+    if (!heap_empty(&t->locks_hold)) {
+        struct lock *l = heap_entry(heap_max(&t->locks_hold), struct lock, elem);
+        if (l->priority > priority)
+            priority = l->priority;
+    }
+    return priority;
+}
+
+/** Yields the CPU if T, or the highest-priority ready thread if
+   T is null, outranks the running thread.  With the fair
+   scheduler, vruntime decides instead of priority.  Within an
+   interrupt handler, the yield is deferred until the handler
+   returns.  A ready EDF thread outranks any other thread, and
+   an earlier deadline outranks a later one. */
 void thread_check_priority_yield(struct thread *t){
-    if(t == NULL){
-        t = list_entry(list_max(&ready_list, thread_list_priority_less, NULL),struct thread, elem);
+    bool preempt;
+
+    if (edf_check_preempt())
+        preempt = true;
+    else if (is_edf_thread(thread_current()))
+        preempt = false;
+    else if (thread_cfs)
+        preempt = cfs_check_preempt(t);
+    else {
+        int priority = t != NULL ? t->priority : ready_queue_max_priority();
+        preempt = priority > thread_current()->priority;
     }
-    if(t->priority > thread_current()->priority){
+
+    if(preempt){
         if(intr_context()){
             intr_yield_on_return();
         }
@@ -636,38 +1519,154 @@ calculate_priority (struct list_elem *e, void *aux UNUSED)
     struct thread *t = list_entry (e, struct thread, allelem);
     if (t != idle_thread)
     {
-        t->priority = PRI_MAX - CONVERT_TO_INT_NEAREST (DIVIDE_X_N(t->recent_cpu, 4)) -  t->nice * 2;
+        int priority = PRI_MAX - CONVERT_TO_INT_NEAREST (DIVIDE_X_N(t->recent_cpu, 4)) -  t->nice * 2;
         /* Make sure it falls in the priority boundry */
-        if (t->priority < PRI_MIN)
+        if (priority < PRI_MIN)
         {
-            t->priority = PRI_MIN;
+            priority = PRI_MIN;
         }
-        else if (t->priority > PRI_MAX)
+        else if (priority > PRI_MAX)
         {
-            t->priority = PRI_MAX;
+            priority = PRI_MAX;
         }
+        thread_update_priority (t, priority);
     }
 }
 
-void
-calculate_recent_cpu (struct list_elem *e, void *aux UNUSED)
+/** Applies to T's recent_cpu every per-second decay it has
+   missed since its mlfqs_epoch.  Interrupts must be off. */
+static void
+mlfqs_catch_up (struct thread *t)
 {
-    struct thread *t = list_entry (e, struct thread, allelem);
-    if (t != idle_thread)
+    ASSERT (mlfqs_epoch - t->mlfqs_epoch <= MLFQS_EPOCH_HISTORY);
+
+    while (t->mlfqs_epoch != mlfqs_epoch)
     {
         /* load_avg and recent_cpu are fixed-point numbers */
-        int term = MULTIPLE_X_N (load_avg, 2);
-        int coefficient = DIVIDE_X_Y(term, ADD_X_N(term, 1));
+        int coefficient = mlfqs_decay_coef[t->mlfqs_epoch % MLFQS_EPOCH_HISTORY];
         t->recent_cpu = ADD_X_N(MULTIPLE_X_Y(coefficient, t->recent_cpu),t->nice);
+        t->mlfqs_epoch++;
+    }
+}
+
+/** Queues running or ready thread T to have its priority
+   recomputed at the next priority update. */
+static void
+mlfqs_mark_dirty (struct thread *t)
+{
+    if (!t->mlfqs_dirty)
+    {
+        t->mlfqs_dirty = true;
+        list_push_back (&mlfqs_dirty_list, &t->mlfqs_elem);
+    }
+}
+
+/** Once-per-second update: recomputes load_avg and the decay
+   coefficient, then decays recent_cpu of the running and ready
+   threads, and of blocked threads in wait queues, whose new
+   priorities reorder those queues at once.  Other blocked threads
+   are decayed when they wake, or here once they fall
+   MLFQS_EPOCH_HISTORY epochs behind, so that the coefficients they
+   need are never overwritten. */
+static void
+mlfqs_update_load_avg (void)
+{
+    struct thread *cur = thread_current ();
+    struct list_elem *e;
+    int term;
+    int i;
+
+    calculate_load_avg ();
+    term = MULTIPLE_X_N (load_avg, 2);
+
+    while (!list_empty (&mlfqs_lazy_list))
+    {
+        struct thread *t = list_entry (list_front (&mlfqs_lazy_list),
+                                       struct thread, mlfqs_elem);
+        if (mlfqs_epoch - t->mlfqs_epoch < MLFQS_EPOCH_HISTORY)
+            break;
+        mlfqs_catch_up (t);
+        calculate_priority (&t->allelem, NULL);
+        list_push_back (&mlfqs_lazy_list, list_pop_front (&mlfqs_lazy_list));
+    }
+
+    mlfqs_decay_coef[mlfqs_epoch % MLFQS_EPOCH_HISTORY] = DIVIDE_X_Y(term, ADD_X_N(term, 1));
+    mlfqs_epoch++;
+
+    if (cur != idle_thread)
+    {
+        mlfqs_catch_up (cur);
+        mlfqs_mark_dirty (cur);
+    }
+    for (e = list_begin (&mlfqs_waiting_list);
+         e != list_end (&mlfqs_waiting_list); e = list_next (e))
+    {
+        struct thread *t = list_entry (e, struct thread, mlfqs_elem);
+        mlfqs_catch_up (t);
+        calculate_priority (&t->allelem, NULL);
+    }
+    for (i = 0; i < PRI_CNT; i++)
+    {
+        struct list *q = &ready_queues[i];
+
+        for (e = list_begin (q); e != list_end (q); e = list_next (e))
+        {
+            struct thread *t = list_entry (e, struct thread, elem);
+            mlfqs_catch_up (t);
+            mlfqs_mark_dirty (t);
+        }
     }
 }
 
+/** Recomputes the priority of every thread whose recent_cpu
+   changed since the last call. */
+static void
+mlfqs_update_priorities (void)
+{
+    while (!list_empty (&mlfqs_dirty_list))
+    {
+        struct thread *t = list_entry (list_pop_front (&mlfqs_dirty_list),
+                                       struct thread, mlfqs_elem);
+        t->mlfqs_dirty = false;
+        calculate_priority (&t->allelem, NULL);
+    }
+}
+
+/** Moves running thread T, which is about to block, onto the
+   waiting list if it is in a wait queue, or else the lazy list.
+   Interrupts must be off. */
+static void
+mlfqs_sleep (struct thread *t)
+{
+    if (t->mlfqs_dirty)
+    {
+        list_remove (&t->mlfqs_elem);
+        t->mlfqs_dirty = false;
+        calculate_priority (&t->allelem, NULL);
+    }
+    if (t != idle_thread)
+        list_push_back (t->waiting != NULL
+                        ? &mlfqs_waiting_list : &mlfqs_lazy_list,
+                        &t->mlfqs_elem);
+}
+
+/** Takes blocked thread T off the lazy or waiting list and
+   brings its recent_cpu and priority up to date before it is
+   queued to run.  Interrupts must be off. */
+static void
+mlfqs_wake (struct thread *t)
+{
+    list_remove (&t->mlfqs_elem);
+    mlfqs_catch_up (t);
+    calculate_priority (&t->allelem, NULL);
+}
+
 void
 calculate_load_avg (void)
 {
     int ready_threads;
     struct thread *cur = thread_current ();
-    int ready_list_size = list_size (&ready_list);
+    int ready_list_size = ready_cnt;
 
     if (cur != idle_thread)
     {
@@ -681,6 +1680,9 @@ calculate_load_avg (void)
                MULTIPLE_X_N( DIVIDE_X_N(CONVERT_TO_FP (1), 60), ready_threads);
 }
 
+/** Invokes FUNC on each thread, passing along AUX.
+   This function must be called with interrupts off, and FUNC
+   must not sleep. */
 void thread_foreach(thread_action_func *func, void *aux)
 {
     struct list_elem *e;
@@ -694,3 +1696,21 @@ void thread_foreach(thread_action_func *func, void *aux)
         func(t, aux);
     }
 }
+
+/** Invokes FUNC on each thread, passing along AUX, with
+   interrupts left as they are.  The walk is an RCU read-side
+   critical section, so FUNC must not sleep, but no thread can
+   exit and free its page before it ends. */
+void thread_foreach_rcu(thread_action_func *func, void *aux)
+{
+    struct list_elem *e;
+
+    rcu_read_lock();
+    for (e = list_begin(&all_list); e != list_end(&all_list);
+         e = list_next(e))
+    {
+        struct thread *t = list_entry(e, struct thread, allelem);
+        func(t, aux);
+    }
+    rcu_read_unlock();
+}
@@ -3,6 +3,7 @@
 
 #include <debug.h>
 #include <list.h>
+#include <rbtree.h>
 #include <stdint.h>
 #include "threads/synch.h"
 /** States in a thread's life cycle. */
@@ -28,6 +29,15 @@ typedef int tid_t;
 #define NICE_MIN -20
 #define NICE_INITIAL 0
 #define NICE_MAX 20
+/** Stride scheduling tickets. */
+#define TICKETS_MIN 1                   /**< Fewest tickets. */
+#define TICKETS_DEFAULT 100             /**< Default tickets. */
+#define TICKETS_MAX 1000                /**< Most tickets. */
+
+/** Earliest-deadline-first real-time threads may together claim
+   at most this percentage of the CPU. */
+#define EDF_UTIL_MAX 95
+
 /* recent_cpu in the begining */
 #define RECENT_CPU_INITIAL 0
 #define FRACTION 16384
@@ -98,12 +108,10 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/** The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/** The `elem' member is an element in the run queue (thread.c)
+   while the thread is ready.  A blocked thread instead sits in
+   wait queues (synch.c) through the `struct waiter's chained from
+   `waiting', which usually live on its own stack. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -114,7 +122,9 @@ struct thread
     int priority_origin;                       /**< Original Priority.only change when thread_set_priority only use in donations */
     int priority;        /**< default equals to priority, when donation occurs, update this value, the max donation */
     struct lock *lock_wait;             /**< Lock the thread requests using for nested donate */
-    struct list locks_hold;             /**< List of locks, lock element in synch.h */
+    struct heap locks_hold;             /**< Max-heap of held locks by donated priority */
+    struct waiter *waiting;             /**< Wait queue entries, innermost first */
+    void *fpu;                          /**< FPU save area, or null if FPU never used */
 
     struct list_elem allelem;           /**< List element for all threads list. */
 
@@ -123,6 +133,33 @@ struct thread
 
     int nice;                             /* Thread nice value */
     int recent_cpu;                       /* Thread recent CPU */
+    unsigned mlfqs_epoch;                 /* load_avg epochs folded into recent_cpu */
+    bool mlfqs_dirty;                     /* recent_cpu changed since priority computed */
+    struct list_elem mlfqs_elem;          /* MLFQS dirty or lazy list element */
+
+    int tickets;                          /* Stride scheduling share */
+    int64_t stride;                       /* Pass advance per tick run, STRIDE1 / tickets */
+    int64_t pass;                         /* Stride virtual time; lowest runs next */
+    struct heap_elem stride_elem;         /* Element in a run queue's stride heap */
+
+    int weight;                           /* CFS load weight, from nice */
+    int64_t vruntime;                     /* CFS weighted runtime in ns; lowest runs next */
+    int64_t exec_start;                   /* timer_ns() when last charged to vruntime */
+    struct rb_elem cfs_elem;              /* Element in a run queue's CFS tree */
+
+    int64_t edf_runtime;                  /* EDF budget per period in ticks, or 0 if not EDF */
+    int64_t edf_period;                   /* EDF period in ticks */
+    int64_t edf_rel_deadline;             /* EDF deadline in ticks after each release */
+    int64_t edf_release;                  /* Tick the current job was released */
+    int64_t edf_deadline;                 /* Absolute deadline of the current job */
+    int64_t edf_budget;                   /* Ticks of budget left in the current job */
+    int edf_util;                         /* Admitted share of the CPU */
+    bool edf_throttled;                   /* Waiting for its next period */
+    int edf_misses;                       /* Jobs that missed their deadlines */
+    struct heap_elem edf_elem;            /* Element in a run queue's EDF heap */
+
+    int rcu_nesting;                      /* RCU read-side critical section depth */
+    bool rcu_preempted;                   /* Preemption deferred by a reader */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
@@ -138,11 +175,25 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/** If true, use the stride (proportional-share) scheduler, which
+   ignores priorities and gives each thread CPU time in proportion
+   to its tickets.  Controlled by kernel command-line option
+   "-stride". */
+extern bool thread_stride;
+
+/** If true, use the fair scheduler, which ignores priorities and
+   runs the thread that has had the least CPU time, weighted by
+   its nice value.  Controlled by kernel command-line option
+   "-cfs". */
+extern bool thread_cfs;
+
 void thread_init (void);
 void thread_start (void);
 
 void thread_tick (void);
+void thread_idle_tick (void);
 void thread_print_stats (void);
+void thread_cache_stats (size_t *hits, size_t *misses);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -150,6 +201,8 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
 void thread_block (void);
 void thread_unblock (struct thread *);
 void thread_check_priority_yield(struct thread *t);
+void thread_update_priority(struct thread *t, int priority);
+int thread_effective_priority(const struct thread *t);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -157,10 +210,12 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /** Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
 void thread_foreach (thread_action_func *, void *);
+void thread_foreach_rcu (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
@@ -173,10 +228,16 @@ bool thread_alllist_priority_less (const struct list_elem *a,
                                    void *aux);
 int thread_get_nice (void);
 void thread_set_nice (int);
+int thread_get_tickets (void);
+void thread_set_tickets (int);
+
+bool thread_set_deadline (int64_t runtime, int64_t period, int64_t deadline);
+void thread_clear_deadline (void);
+void thread_deadline_yield (void);
+int thread_deadline_misses (void);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
 void calculate_load_avg (void);
-void calculate_recent_cpu (struct list_elem *e, void *aux UNUSED);
 void calculate_priority (struct list_elem *e, void *aux UNUSED);
 #endif /**< threads/thread.h */
@@ -0,0 +1,113 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/** Number of worker threads.  Work items may run concurrently
+   with each other when this is greater than 1. */
+#define WORKER_CNT 1
+
+/** Items scheduled but not yet taken by a worker, in order. */
+static struct list work_list;
+
+/** Upped whenever work_list goes from empty to nonempty. */
+static struct semaphore work_ready;
+
+static thread_func worker;
+
+/** Initializes the work queue.  Work may be scheduled from then
+   on, even by interrupt handlers, and runs once workqueue_start()
+   has started the workers.  Must be called before interrupts are
+   enabled. */
+void
+workqueue_init (void) 
+{
+  list_init (&work_list);
+  sema_init (&work_ready, 0);
+}
+
+/** Starts the work queue's worker threads.  Must be called after
+   thread_start(). */
+void
+workqueue_start (void) 
+{
+  int i;
+
+  for (i = 0; i < WORKER_CNT; i++)
+    thread_create ("kworker", PRI_MAX, worker, NULL);
+}
+
+/** Initializes W to run FUNC(AUX) each time it is scheduled. */
+void
+work_init (struct work *w, work_func *func, void *aux) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/** Queues W to run in a worker thread.  Returns false, doing
+   nothing, if W is already queued and has not started yet;
+   once it has started, it may be queued again, even by its own
+   function.
+
+   This function may be called from an interrupt handler. */
+bool
+work_schedule (struct work *w) 
+{
+  enum intr_level old_level;
+  bool queued = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (!w->pending) 
+    {
+      bool was_empty = list_empty (&work_list);
+
+      w->pending = true;
+      list_push_back (&work_list, &w->elem);
+      if (was_empty)
+        sema_up (&work_ready);
+      queued = true;
+    }
+  intr_set_level (old_level);
+  return queued;
+}
+
+/** Worker thread.  Takes everything queued so far as one batch,
+   with interrupts off only long enough to splice the list, and
+   runs the batch in order with interrupts on. */
+static void
+worker (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      struct list batch;
+      enum intr_level old_level;
+
+      sema_down (&work_ready);
+
+      list_init (&batch);
+      old_level = intr_disable ();
+      if (!list_empty (&work_list))
+        list_splice (list_end (&batch),
+                     list_begin (&work_list), list_end (&work_list));
+      intr_set_level (old_level);
+
+      while (!list_empty (&batch)) 
+        {
+          struct work *w = list_entry (list_pop_front (&batch),
+                                       struct work, elem);
+
+          old_level = intr_disable ();
+          w->pending = false;
+          intr_set_level (old_level);
+          w->func (w->aux);
+        }
+    }
+}
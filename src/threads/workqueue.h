@@ -0,0 +1,33 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/** Deferred work.
+
+   Interrupt handlers may not sleep and should not run long with
+   interrupts off.  Work that can wait a little, or that needs to
+   sleep, is queued instead as a struct work and run later by a
+   high-priority kernel worker thread.  The struct work is
+   provided by the caller, usually embedded in a longer-lived
+   structure, so queuing never allocates memory. */
+
+/** Function run by a work item, given the item's AUX. */
+typedef void work_func (void *aux);
+
+/** A work item. */
+struct work 
+  {
+    struct list_elem elem;      /**< Element in the work queue. */
+    work_func *func;            /**< Function to run. */
+    void *aux;                  /**< Argument to `func'. */
+    bool pending;               /**< Queued but not yet started? */
+  };
+
+void workqueue_init (void);
+void workqueue_start (void);
+void work_init (struct work *, work_func *, void *aux);
+bool work_schedule (struct work *);
+
+#endif /**< threads/workqueue.h */
@@ -8,6 +8,8 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static uint32_t *lookup_large (uint32_t *pd, const void *vaddr);
+static bool split_large_page (uint32_t *pd, uint32_t *pde);
 
 /** Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -16,7 +18,7 @@ static void invalidate_pagedir (uint32_t *);
 uint32_t *
 pagedir_create (void) 
 {
-  uint32_t *pd = palloc_get_page (0);
+  uint32_t *pd = palloc_get_page (PAL_TAG (MEM_PAGEDIR));
   if (pd != NULL)
     memcpy (pd, init_page_dir, PGSIZE);
   return pd;
@@ -34,7 +36,9 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if (pde_is_large (*pde))
+      palloc_free_multiple (pde_get_large_page (*pde), PTSPAN / PGSIZE);
+    else if (*pde & PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -52,7 +56,11 @@ pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR is in a 4 MB user page, the page is first split into
+   4 kB pages, and a null pointer is returned if that fails.
+   4 MB kernel pages are never split, so a null pointer is
+   returned for them. */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -66,11 +74,14 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   /* Check for a page table for VADDR.
      If one is missing, create one if requested. */
   pde = pd + pd_no (vaddr);
+  if (pde_is_large (*pde)
+      && (!is_user_vaddr (vaddr) || !split_large_page (pd, pde)))
+    return NULL;
   if (*pde == 0) 
     {
       if (create)
         {
-          pt = palloc_get_page (PAL_ZERO);
+          pt = palloc_get_page (PAL_ZERO | PAL_TAG (MEM_PAGEDIR));
           if (pt == NULL) 
             return NULL; 
       
@@ -118,6 +129,37 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/** Adds a mapping in page directory PD from the 4 MB of user
+   virtual memory starting at UPAGE to the 4 MB of physical
+   memory starting at the frame identified by kernel virtual
+   address KPAGE, using a single large page.
+   UPAGE and the physical address of KPAGE must both be multiples
+   of 4 MB, and none of the 4 MB at UPAGE may already be mapped.
+   KPAGE should probably be obtained from the user pool with
+   palloc_get_aligned().
+   If WRITABLE is true, the new pages are read/write;
+   otherwise they are read-only.
+   Returns true if successful, false if the CPU does not support
+   4 MB pages or the range already has a page table, in which
+   case the caller should map 4 kB pages instead. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                        bool writable) 
+{
+  uint32_t *pde;
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (vtop (kpage) % PTSPAN == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (pd != init_page_dir);
+
+  pde = pd + pd_no (upage);
+  if (!pse_enabled || *pde != 0)
+    return false;
+  *pde = pde_create_large_user (kpage, writable);
+  return true;
+}
+
 /** Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -125,9 +167,14 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 void *
 pagedir_get_page (uint32_t *pd, const void *uaddr) 
 {
-  uint32_t *pte;
+  uint32_t *pde, *pte;
 
   ASSERT (is_user_vaddr (uaddr));
+
+  pde = lookup_large (pd, uaddr);
+  if (pde != NULL)
+    return (uint8_t *) pde_get_large_page (*pde) + ((uintptr_t) uaddr
+                                                    & (PTSPAN - 1));
   
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
@@ -139,8 +186,11 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
 /** Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
-   UPAGE need not be mapped. */
-void
+   UPAGE need not be mapped.  If UPAGE is in a 4 MB page, that
+   page is split into 4 kB pages first.
+   Returns true if successful, false if there was no memory to
+   split a 4 MB page, in which case UPAGE stays mapped. */
+bool
 pagedir_clear_page (uint32_t *pd, void *upage) 
 {
   uint32_t *pte;
@@ -148,12 +198,16 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (is_user_vaddr (upage));
 
+  if (pde_is_large (pd[pd_no (upage)])
+      && !split_large_page (pd, pd + pd_no (upage)))
+    return false;
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
       invalidate_pagedir (pd);
     }
+  return true;
 }
 
 /** Returns true if the PTE for virtual page VPAGE in PD is dirty,
@@ -163,7 +217,12 @@ pagedir_clear_page (uint32_t *pd, void *upage)
 bool
 pagedir_is_dirty (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pde = lookup_large (pd, vpage);
+  uint32_t *pte;
+
+  if (pde != NULL)
+    return (*pde & PTE_D) != 0;
+  pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -192,7 +251,12 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
 bool
 pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pde = lookup_large (pd, vpage);
+  uint32_t *pte;
+
+  if (pde != NULL)
+    return (*pde & PTE_A) != 0;
+  pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -243,6 +307,43 @@ active_pd (void)
   return ptov (pd);
 }
 
+/** Returns the PDE in PD for virtual address VADDR if it maps a
+   4 MB page, otherwise a null pointer. */
+static uint32_t *
+lookup_large (uint32_t *pd, const void *vaddr) 
+{
+  uint32_t *pde;
+
+  ASSERT (pd != NULL);
+
+  pde = pd + pd_no (vaddr);
+  return pde_is_large (*pde) ? pde : NULL;
+}
+
+/** Replaces the 4 MB page mapped by *PDE, in PD, by a page table
+   that maps the same memory with 4 kB pages, with the same
+   permissions, accessed bit, and dirty bit.  After that the frames
+   are freed one at a time, like any others.  Returns true if
+   successful, false if memory allocation failed. */
+static bool
+split_large_page (uint32_t *pd, uint32_t *pde) 
+{
+  uint32_t flags = *pde & (PTE_FLAGS & ~PTE_PS);
+  uint8_t *kpage = pde_get_large_page (*pde);
+  uint32_t *pt;
+  size_t i;
+
+  pt = palloc_get_page (PAL_TAG (MEM_PAGEDIR));
+  if (pt == NULL)
+    return false;
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = vtop (kpage + PGSIZE * i) | flags;
+
+  *pde = pde_create (pt);
+  invalidate_pagedir (pd);
+  return true;
+}
+
 /** Seom page table changes can cause the CPU's translation
    lookaside buffer (TLB) to become out-of-sync with the page
    table.  When this happens, we have to "invalidate" the TLB by
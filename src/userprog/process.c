@@ -15,6 +15,7 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 
@@ -33,7 +34,7 @@ process_execute (const char *file_name)
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
+  fn_copy = palloc_get_page (PAL_TAG (MEM_PROCESS));
   if (fn_copy == NULL)
     return TID_ERROR;
   strlcpy (fn_copy, file_name, PGSIZE);
@@ -395,9 +396,44 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
          and zero the final PAGE_ZERO_BYTES bytes. */
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      uint8_t *kpage;
+
+      /* Map 4 MB at once with a large page where the segment
+         covers all of it, if the CPU and memory allow.  Otherwise
+         fall back to 4 kB pages. */
+      if (read_bytes + zero_bytes >= PTSPAN
+          && (uintptr_t) upage % PTSPAN == 0 && pse_enabled) 
+        {
+          size_t large_read_bytes = read_bytes < PTSPAN ? read_bytes : PTSPAN;
+
+          kpage = palloc_get_aligned (PAL_USER, PTSPAN / PGSIZE,
+                                      PTSPAN / PGSIZE);
+          if (kpage != NULL) 
+            {
+              if (pagedir_set_large_page (thread_current ()->pagedir,
+                                          upage, kpage, writable)) 
+                {
+                  /* The page is mapped already, so on failure
+                     pagedir_destroy() frees it. */
+                  if (file_read (file, kpage, large_read_bytes)
+                      != (int) large_read_bytes)
+                    return false;
+                  memset (kpage + large_read_bytes, 0,
+                          PTSPAN - large_read_bytes);
+
+                  read_bytes -= large_read_bytes;
+                  zero_bytes -= PTSPAN - large_read_bytes;
+                  upage += PTSPAN;
+                  continue;
+                }
+
+              /* A page table already covers some of the range. */
+              palloc_free_multiple (kpage, PTSPAN / PGSIZE);
+            }
+        }
 
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
+      kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
         return false;
 